@@ -104,6 +104,34 @@ set_target_properties(cudaq::cudaq-qpp-cpu-target PROPERTIES
   IMPORTED_SONAME "libnvqir-qpp${CMAKE_SHARED_LIBRARY_SUFFIX}"
   IMPORTED_LINK_INTERFACE_LIBRARIES "cudaq::cudaq-platform-default;cudaq::cudaq-em-default")
 
+# QPP CPU FP32 Target
+add_library(cudaq::cudaq-qpp-cpu-fp32-target SHARED IMPORTED)
+set_target_properties(cudaq::cudaq-qpp-cpu-fp32-target PROPERTIES
+  IMPORTED_LOCATION "${CUDAQ_LIBRARY_DIR}/libnvqir-qpp-fp32${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_SONAME "libnvqir-qpp-fp32${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_LINK_INTERFACE_LIBRARIES "cudaq::cudaq-platform-default;cudaq::cudaq-em-default")
+
+# QPP CPU Memory-Mapped Target
+add_library(cudaq::cudaq-qpp-cpu-mmap-target SHARED IMPORTED)
+set_target_properties(cudaq::cudaq-qpp-cpu-mmap-target PROPERTIES
+  IMPORTED_LOCATION "${CUDAQ_LIBRARY_DIR}/libnvqir-qpp-mmap${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_SONAME "libnvqir-qpp-mmap${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_LINK_INTERFACE_LIBRARIES "cudaq::cudaq-platform-default;cudaq::cudaq-em-default")
+
+# QPP CPU MPI Target
+add_library(cudaq::cudaq-qpp-cpu-mpi-target SHARED IMPORTED)
+set_target_properties(cudaq::cudaq-qpp-cpu-mpi-target PROPERTIES
+  IMPORTED_LOCATION "${CUDAQ_LIBRARY_DIR}/libnvqir-qpp-mpi${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_SONAME "libnvqir-qpp-mpi${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_LINK_INTERFACE_LIBRARIES "cudaq::cudaq-platform-default;cudaq::cudaq-em-default")
+
+# QPP CPU Factored Target
+add_library(cudaq::cudaq-qpp-cpu-factored-target SHARED IMPORTED)
+set_target_properties(cudaq::cudaq-qpp-cpu-factored-target PROPERTIES
+  IMPORTED_LOCATION "${CUDAQ_LIBRARY_DIR}/libnvqir-qpp-factored${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_SONAME "libnvqir-qpp-factored${CMAKE_SHARED_LIBRARY_SUFFIX}"
+  IMPORTED_LINK_INTERFACE_LIBRARIES "cudaq::cudaq-platform-default;cudaq::cudaq-em-default")
+
 # QPP CPU DensityMatrix Target
 add_library(cudaq::cudaq-qpp-density-matrix-cpu-target SHARED IMPORTED)
 set_target_properties(cudaq::cudaq-qpp-density-matrix-cpu-target PROPERTIES
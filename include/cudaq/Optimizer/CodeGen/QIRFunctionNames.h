@@ -115,6 +115,11 @@ static constexpr const char QISApplyKrausChannel[] =
 
 static constexpr const char QISTrap[] = "__quantum__qis__trap";
 
+/// Detector and logical observable annotations on the measurement record.
+static constexpr const char QISDetector[] = "__quantum__qis__detector";
+static constexpr const char QISObservableInclude[] =
+    "__quantum__qis__observable_include";
+
 /// Since apply noise is actually a call back to `C++` code, the `QIR` data type
 /// `Array` of `Qubit*` must be converted into a `cudaq::qvector`, which is
 /// presently a `std::vector<cudaq::qubit>` but with an extremely restricted
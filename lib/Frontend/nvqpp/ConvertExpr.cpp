@@ -1661,6 +1661,24 @@ bool QuakeBridgeVisitor::VisitCallExpr(clang::CallExpr *x) {
       return false;
     }
 
+    if (funcName == "detector" || funcName == "logical_observable") {
+      // The lookbacks are passed as a `const std::vector<std::int64_t>&`.
+      Value lookbacks = args.back();
+      if (auto ptrTy = dyn_cast<cc::PointerType>(lookbacks.getType()))
+        if (isa<cc::StdvecType>(ptrTy.getElementType()))
+          lookbacks = builder.create<cc::LoadOp>(loc, lookbacks);
+      if (!isa<cc::StdvecType>(lookbacks.getType())) {
+        reportClangError(x, mangler,
+                         "measurement lookbacks must be a std::vector.");
+        return false;
+      }
+      if (funcName == "detector")
+        builder.create<quake::DetectorOp>(loc, lookbacks);
+      else
+        builder.create<quake::ObservableIncludeOp>(loc, args[0], lookbacks);
+      return true;
+    }
+
     if (funcName == "mx" || funcName == "my" || funcName == "mz") {
       // Measurements always return a bool or a std::vector<bool>.
       bool useStdvec =
@@ -443,6 +443,57 @@ struct ApplyNoiseOpRewrite : public OpConversionPattern<quake::ApplyNoiseOp> {
   }
 };
 
+/// Pass the data and size of the lookbacks of a detector or observable
+/// annotation, appending them to \p args.
+static void appendLookbacks(Location loc, Value lookbacks,
+                            SmallVectorImpl<Value> &args,
+                            ConversionPatternRewriter &rewriter) {
+  auto eleTy =
+      cast<cudaq::cc::StdvecType>(lookbacks.getType()).getElementType();
+  auto dataTy = cudaq::cc::PointerType::get(cudaq::cc::ArrayType::get(eleTy));
+  Value data =
+      rewriter.create<cudaq::cc::StdvecDataOp>(loc, dataTy, lookbacks);
+  args.push_back(rewriter.create<cudaq::cc::CastOp>(
+      loc, cudaq::cc::PointerType::get(eleTy), data));
+  args.push_back(rewriter.create<cudaq::cc::StdvecSizeOp>(
+      loc, rewriter.getI64Type(), lookbacks));
+}
+
+struct DetectorOpRewrite : public OpConversionPattern<quake::DetectorOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(quake::DetectorOp detector, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    SmallVector<Value> args;
+    appendLookbacks(detector.getLoc(), adaptor.getLookbacks(), args, rewriter);
+    rewriter.replaceOpWithNewOp<func::CallOp>(
+        detector, TypeRange{}, cudaq::opt::QISDetector, args);
+    return success();
+  }
+};
+
+struct ObservableIncludeOpRewrite
+    : public OpConversionPattern<quake::ObservableIncludeOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(quake::ObservableIncludeOp observable, OpAdaptor adaptor,
+                  ConversionPatternRewriter &rewriter) const override {
+    auto loc = observable.getLoc();
+    auto i64Ty = rewriter.getI64Type();
+    Value index = adaptor.getIndex();
+    if (index.getType() != i64Ty)
+      index = rewriter.create<cudaq::cc::CastOp>(
+          loc, i64Ty, index, cudaq::cc::CastOpMode::Unsigned);
+    SmallVector<Value> args{index};
+    appendLookbacks(loc, adaptor.getLookbacks(), args, rewriter);
+    rewriter.replaceOpWithNewOp<func::CallOp>(
+        observable, TypeRange{}, cudaq::opt::QISObservableInclude, args);
+    return success();
+  }
+};
+
 struct MaterializeConstantArrayOpRewrite
     : public OpConversionPattern<cudaq::codegen::MaterializeConstantArrayOp> {
   using OpConversionPattern::OpConversionPattern;
@@ -1727,7 +1778,8 @@ static void commonClassicalHandlingPatterns(RewritePatternSet &patterns,
 static void commonQuakeHandlingPatterns(RewritePatternSet &patterns,
                                         TypeConverter &typeConverter,
                                         MLIRContext *ctx) {
-  patterns.insert<ApplyOpTrap, GetMemberOpRewrite, MakeStruqOpRewrite,
+  patterns.insert<ApplyOpTrap, DetectorOpRewrite, GetMemberOpRewrite,
+                  MakeStruqOpRewrite, ObservableIncludeOpRewrite,
                   RelaxSizeOpErase, VeqSizeOpRewrite>(typeConverter, ctx);
 }
 
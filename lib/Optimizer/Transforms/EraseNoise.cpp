@@ -23,14 +23,17 @@ namespace cudaq::opt {
 using namespace mlir;
 
 /// \file
-/// This pass exists simply to remove all the quake.apply_noise Ops from the IR.
+/// This pass exists simply to remove all the quake.apply_noise Ops from the IR,
+/// along with the quake.detector and quake.observable_include annotations
+/// that only make sense with noise.
 
 namespace {
-class EraseApplyNoisePattern : public OpRewritePattern<quake::ApplyNoiseOp> {
+template <typename OP>
+class EraseNoisePattern : public OpRewritePattern<OP> {
 public:
-  using OpRewritePattern::OpRewritePattern;
+  using OpRewritePattern<OP>::OpRewritePattern;
 
-  LogicalResult matchAndRewrite(quake::ApplyNoiseOp noise,
+  LogicalResult matchAndRewrite(OP noise,
                                 PatternRewriter &rewriter) const override {
     rewriter.eraseOp(noise);
     return success();
@@ -46,7 +49,9 @@ public:
     LLVM_DEBUG(llvm::dbgs() << "Before erasure:\n" << *op << "\n\n");
     auto *ctx = &getContext();
     RewritePatternSet patterns(ctx);
-    patterns.insert<EraseApplyNoisePattern>(ctx);
+    patterns.insert<EraseNoisePattern<quake::ApplyNoiseOp>,
+                    EraseNoisePattern<quake::DetectorOp>,
+                    EraseNoisePattern<quake::ObservableIncludeOp>>(ctx);
     if (failed(applyPatternsAndFoldGreedily(op, std::move(patterns))))
       signalPassFailure();
     LLVM_DEBUG(llvm::dbgs() << "After erasure:\n" << *op << "\n\n");
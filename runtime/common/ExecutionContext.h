@@ -58,6 +58,12 @@ public:
   /// statements on measure results.
   bool hasConditionalsOnMeasureResults = false;
 
+  /// @brief The caller re-executes the kernel until `shots` shots are
+  /// collected, so a single execution may return results for several shots.
+  /// This lets simulators branch at measurements instead of running kernels
+  /// with conditionals one shot at a time.
+  bool allowMeasurementBranching = false;
+
   /// @brief Noise model to apply to the current execution.
   const noise_model *noiseModel = nullptr;
 
@@ -127,5 +133,12 @@ public:
   /// @brief Whether or not to simply concatenate measurements in execution
   /// order.
   bool explicitMeasurements = false;
+
+  /// @brief Whether simulators that support detectors should export the
+  /// detector error model of the executed circuit under the noise model.
+  bool exportDetectorErrorModel = false;
+
+  /// @brief The exported detector error model, in the Stim text format.
+  std::optional<std::string> detectorErrorModel = std::nullopt;
 };
 } // namespace cudaq
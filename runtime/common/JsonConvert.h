@@ -61,7 +61,7 @@ namespace cudaq {
 inline void to_json(json &j, const ExecutionResult &result) {
   j = json{{"counts", result.counts},
            {"registerName", result.registerName},
-           {"sequentialData", result.sequentialData}};
+           {"sequentialData", result.getSequentialData()}};
   if (result.expectationValue.has_value())
     j["expectationValue"] = result.expectationValue.value();
 }
@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <numeric>
 #include <string.h>
+#include <string_view>
 
 #include <iostream>
 #include <map>
@@ -55,6 +56,64 @@ std::string extractNameFromData(std::vector<std::size_t> &data,
   return name;
 }
 
+std::uint64_t PackedShots::word(std::size_t shot, std::size_t k) const {
+  const std::uint64_t *row = words + shot * rowStride;
+  const std::size_t first = bitOffset + 64 * k;
+  const std::size_t shift = first % 64;
+  std::uint64_t value = row[first / 64] >> shift;
+  // The rest of the bits are in the next word of the row, if it holds any
+  // measured bits.
+  if (shift && first / 64 + 1 < (bitOffset + numBits + 63) / 64)
+    value |= row[first / 64 + 1] << (64 - shift);
+  const std::size_t remaining = numBits - 64 * k;
+  if (remaining < 64)
+    value &= (1ULL << remaining) - 1;
+  return value;
+}
+
+std::string PackedShots::bitString(std::size_t shot) const {
+  std::string bits(numBits, '0');
+  for (std::size_t b = 0; b < numBits; b++)
+    if (bit(shot, b))
+      bits[b] = '1';
+  return bits;
+}
+
+std::vector<std::string> PackedShots::bitStrings() const {
+  std::vector<std::string> strings;
+  strings.reserve(numShots);
+  for (std::size_t shot = 0; shot < numShots; shot++)
+    strings.push_back(bitString(shot));
+  return strings;
+}
+
+CountsDictionary PackedShots::counts() const {
+  // The measured words of each shot, so that shots can be hashed and compared
+  // as byte strings whatever the bit offset.
+  const std::size_t numWords = (numBits + 63) / 64;
+  std::vector<std::uint64_t> keys(numShots * numWords);
+  for (std::size_t shot = 0; shot < numShots; shot++)
+    for (std::size_t k = 0; k < numWords; k++)
+      keys[shot * numWords + k] = word(shot, k);
+
+  // Map each distinct shot to its number of occurrences and one shot index.
+  std::unordered_map<std::string_view, std::pair<std::size_t, std::size_t>>
+      distinct;
+  for (std::size_t shot = 0; shot < numShots; shot++) {
+    std::string_view key(
+        reinterpret_cast<const char *>(keys.data() + shot * numWords),
+        numWords * sizeof(std::uint64_t));
+    auto [iter, inserted] = distinct.try_emplace(key, 0, shot);
+    iter->second.first++;
+  }
+
+  CountsDictionary result;
+  result.reserve(distinct.size());
+  for (const auto &[key, entry] : distinct)
+    result.emplace(bitString(entry.second), entry.first);
+  return result;
+}
+
 ExecutionResult::ExecutionResult(CountsDictionary c) : counts(c) {}
 ExecutionResult::ExecutionResult(std::string name) : registerName(name) {}
 ExecutionResult::ExecutionResult(double e) : expectationValue(e) {}
@@ -68,17 +127,28 @@ ExecutionResult::ExecutionResult(CountsDictionary c, double e)
     : counts(c), expectationValue(e) {}
 ExecutionResult::ExecutionResult(const ExecutionResult &other)
     : counts(other.counts), expectationValue(other.expectationValue),
-      registerName(other.registerName), sequentialData(other.sequentialData) {}
+      registerName(other.registerName), sequentialData(other.sequentialData),
+      packedShots(other.packedShots) {}
 
 ExecutionResult &ExecutionResult::operator=(const ExecutionResult &other) {
   counts = other.counts;
   expectationValue = other.expectationValue;
   registerName = other.registerName;
   sequentialData = other.sequentialData;
+  packedShots = other.packedShots;
   return *this;
 }
 
+void ExecutionResult::unpackShots() {
+  if (!packedShots)
+    return;
+  if (sequentialData.empty())
+    sequentialData = packedShots->bitStrings();
+  packedShots.reset();
+}
+
 void ExecutionResult::appendResult(std::string bitString, std::size_t count) {
+  unpackShots();
   auto [iter, inserted] = counts.emplace(std::move(bitString), count);
   if (!inserted)
     iter->second += count;
@@ -201,6 +271,8 @@ void sample_result::append(ExecutionResult &result, bool concatenate) {
   if (iter != sampleResults.end()) {
     auto &existingExecResult = iter->second;
     if (concatenate) {
+      existingExecResult.unpackShots();
+      result.unpackShots();
       // Stitch the bitstrings together
       if (this->totalShots == result.sequentialData.size()) {
         existingExecResult.counts.clear();
@@ -247,10 +319,12 @@ sample_result &sample_result::operator+=(const sample_result &other) {
           ourCounts.insert({bits, count});
       }
 
-      if (!otherResults.second.sequentialData.empty())
-        sr.sequentialData.insert(sr.sequentialData.end(),
-                                 otherResults.second.sequentialData.begin(),
-                                 otherResults.second.sequentialData.end());
+      const auto otherData = otherResults.second.getSequentialData();
+      if (!otherData.empty()) {
+        sr.unpackShots();
+        sr.sequentialData.insert(sr.sequentialData.end(), otherData.begin(),
+                                 otherData.end());
+      }
     }
     if (regName == GlobalRegisterName)
       totalShots += other.totalShots;
@@ -303,6 +377,11 @@ sample_result::sequential_data(const std::string_view registerName) const {
   return retrieve_result(registerName.data()).getSequentialData();
 }
 
+std::optional<PackedShots>
+sample_result::packed_shots(const std::string_view registerName) const {
+  return retrieve_result(registerName.data()).packedShots;
+}
+
 CountsDictionary::iterator sample_result::begin() {
   return retrieve_result(GlobalRegisterName).counts.begin();
 }
@@ -508,6 +587,7 @@ void sample_result::reorder(const std::vector<std::size_t> &idx,
   result.counts = newCounts;
 
   // Now process the sequential data
+  result.unpackShots();
   for (auto &s : result.sequentialData) {
     std::string newBits(s);
     int i = 0;
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -20,6 +22,52 @@ using CountsDictionary = std::unordered_map<std::string, std::size_t>;
 
 inline static const std::string GlobalRegisterName = "__global__";
 
+/// The `PackedShots` hold the measurement results of a sampling task as
+/// bits, one row of 64-bit words per shot, without a string per shot. Bit `b`
+/// of a shot is bit `bitOffset + b` of its row, with bit `k` of a row in bit
+/// `k % 64` of its word `k / 64`. The words are owned by `storage`, which may
+/// be the simulator's own bit table, so that they are not copied.
+struct PackedShots {
+  /// @brief Number of shots (rows).
+  std::size_t numShots = 0;
+
+  /// @brief Number of measured bits per shot.
+  std::size_t numBits = 0;
+
+  /// @brief Position of the first measured bit in each row.
+  std::size_t bitOffset = 0;
+
+  /// @brief Number of words between the starts of consecutive rows.
+  std::size_t rowStride = 0;
+
+  /// @brief The first word of the first row.
+  const std::uint64_t *words = nullptr;
+
+  /// @brief Owner of the words.
+  std::shared_ptr<const void> storage;
+
+  /// @brief Return bit \p b of shot \p shot.
+  bool bit(std::size_t shot, std::size_t b) const {
+    const std::size_t k = bitOffset + b;
+    return (words[shot * rowStride + k / 64] >> (k % 64)) & 1;
+  }
+
+  /// @brief Return the measured bits `[64 * k, 64 * k + 64)` of shot \p shot,
+  /// the bits past the end of the shot being 0.
+  std::uint64_t word(std::size_t shot, std::size_t k) const;
+
+  /// @brief Return the bit string of shot \p shot.
+  std::string bitString(std::size_t shot) const;
+
+  /// @brief Return the bit strings of all shots, in order.
+  std::vector<std::string> bitStrings() const;
+
+  /// @brief Return the number of times each bit string was observed. Shots
+  /// are collated by their packed words, and a string is only built for each
+  /// distinct one.
+  CountsDictionary counts() const;
+};
+
 /// The `ExecutionResult` models the result of a typical
 /// quantum state sampling task. It will contain the
 /// observed measurement bit strings and corresponding number
@@ -38,6 +86,11 @@ struct ExecutionResult {
   /// @brief Sequential bit strings observed (not collated into a map)
   std::vector<std::string> sequentialData;
 
+  /// @brief Bit-packed shots, if the simulator provided them instead of
+  /// `sequentialData`. The bit strings are only built when requested, see
+  /// `getSequentialData`.
+  std::optional<PackedShots> packedShots;
+
   /// @brief Serialize this sample result to a vector of integers.
   /// Encoding: 1st element is size of the register name N, then next N
   /// represent register name, next is the number of bitstrings M,
@@ -95,7 +148,17 @@ struct ExecutionResult {
   /// @param count
   void appendResult(std::string bitString, std::size_t count);
 
-  std::vector<std::string> getSequentialData() const { return sequentialData; }
+  /// @brief Return the sequential bit strings, built from the packed shots
+  /// if there are any.
+  std::vector<std::string> getSequentialData() const {
+    if (sequentialData.empty() && packedShots)
+      return packedShots->bitStrings();
+    return sequentialData;
+  }
+
+  /// @brief Replace the packed shots, if any, by their bit strings in
+  /// `sequentialData`, before the latter is modified.
+  void unpackShots();
 };
 
 /// @brief The sample_result abstraction wraps a set of `ExecutionResult`s for
@@ -219,6 +282,12 @@ public:
   std::vector<std::string> sequential_data(
       const std::string_view registerName = GlobalRegisterName) const;
 
+  /// @brief Return the bit-packed shots of the given register, if the
+  /// simulator provided them. Registers such as the `__detectors__` reported
+  /// by the `stim` target only hold packed shots, and no counts.
+  std::optional<PackedShots> packed_shots(
+      const std::string_view registerName = GlobalRegisterName) const;
+
   /// @brief Return the number of observed bit strings
   /// @return
   std::size_t
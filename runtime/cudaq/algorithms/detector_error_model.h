@@ -0,0 +1,75 @@
+/****************************************************************-*- C++ -*-****
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#pragma once
+
+#include <concepts>
+
+#include "common/ExecutionContext.h"
+#include "cudaq/platform.h"
+
+namespace cudaq {
+
+// clang-format off
+///
+/// @brief Returns the detector error model of the kernel under the current
+/// noise model, in the Stim text format. The detectors and logical observables
+/// are the ones declared with `cudaq::detector` and
+/// `cudaq::logical_observable`. Only supported on the `stim` target.
+///
+/// \param kernel The quantum callable with non-trivial function signature.
+/// \param args The arguments required for evaluation of the quantum kernel.
+/// \returns The detector error model, which decoders can consume directly.
+///
+/// Usage:
+/// \code{.cpp}
+/// #include <cudaq.h>
+/// #include <cudaq/algorithms/detector_error_model.h>
+///
+/// auto repetition = []() __qpu__ {
+///   cudaq::qvector q(3);
+///   x<cudaq::ctrl>(q[0], q[1]);
+///   x<cudaq::ctrl>(q[2], q[1]);
+///   mz(q[1]);
+///   cudaq::detector({-1});
+/// };
+/// ...
+/// cudaq::set_noise(noise);
+/// std::cout << cudaq::detector_error_model(repetition);
+/// \endcode
+///
+// clang-format on
+#if CUDAQ_USE_STD20
+template <typename QuantumKernel, typename... Args>
+  requires std::invocable<QuantumKernel &, Args...>
+#else
+template <
+    typename QuantumKernel, typename... Args,
+    typename = std::enable_if_t<std::is_invocable_v<QuantumKernel, Args...>>>
+#endif
+std::string detector_error_model(QuantumKernel &&kernel, Args &&...args) {
+  auto &platform = cudaq::get_platform();
+  if (!platform.is_simulator())
+    throw std::runtime_error(
+        "Cannot compute a detector error model on a physical QPU.");
+
+  // A single shot sampling execution, in which the simulator records the
+  // circuit and exports its detector error model.
+  ExecutionContext context("sample", 1);
+  context.exportDetectorErrorModel = true;
+  platform.set_exec_ctx(&context);
+  kernel(std::forward<Args>(args)...);
+  platform.reset_exec_ctx();
+
+  if (!context.detectorErrorModel)
+    throw std::runtime_error("Detector error models are not supported on the "
+                             "current target.");
+  return *context.detectorErrorModel;
+}
+
+} // namespace cudaq
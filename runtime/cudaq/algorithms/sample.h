@@ -60,6 +60,8 @@ runSampling(KernelFunctor &&wrappedKernel, quantum_platform &platform,
   ctx->totalIterations = totalBatchIters;
   ctx->hasConditionalsOnMeasureResults = hasConditionalFeebdback;
   ctx->explicitMeasurements = explicitMeasurements;
+  // The loop below runs until all shots are collected.
+  ctx->allowMeasurementBranching = futureResult == nullptr;
 
 #ifdef CUDAQ_LIBRARY_MODE
   // If we have a kernel that has its quake code registered, we
@@ -139,6 +139,21 @@ public:
   virtual void applyNoise(const kraus_channel &channelName,
                           const std::vector<QuditInfo> &targets) = 0;
 
+  /// @brief Declare a detector over the measurements at the given lookbacks
+  /// into the measurement record (-1 being the latest measurement).
+  virtual void applyDetector(const std::vector<std::int64_t> &lookbacks) {
+    throw std::runtime_error("Detectors are not supported by this execution "
+                             "manager.");
+  }
+
+  /// @brief Include the measurements at the given lookbacks into the logical
+  /// observable with the given index.
+  virtual void applyObservable(std::size_t index,
+                               const std::vector<std::int64_t> &lookbacks) {
+    throw std::runtime_error("Logical observables are not supported by this "
+                             "execution manager.");
+  }
+
   /// Reset the qubit to the |0> state
   virtual void reset(const QuditInfo &target) = 0;
 
@@ -244,6 +244,21 @@ protected:
     simulator()->applyNoise(channel, localT);
   }
 
+  void applyDetector(const std::vector<std::int64_t> &lookbacks) override {
+    if (isInTracerMode())
+      return;
+    flushGateQueue();
+    simulator()->addDetector(lookbacks);
+  }
+
+  void applyObservable(std::size_t index,
+                       const std::vector<std::int64_t> &lookbacks) override {
+    if (isInTracerMode())
+      return;
+    flushGateQueue();
+    simulator()->addObservable(index, lookbacks);
+  }
+
   int measureQudit(const cudaq::QuditInfo &q,
                    const std::string &registerName) override {
     flushRequestedAllocations();
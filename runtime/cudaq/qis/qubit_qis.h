@@ -1376,6 +1376,21 @@ void apply_noise(Args &&...args) {
       details::tuple_slice_last<qubit_arity>(std::forward_as_tuple(args...)));
 }
 
+/// @brief Declare a detector: the parity of the measurements at the given
+/// lookbacks into the measurement record, -1 being the latest measurement.
+/// Without noise, this parity must be the same in every shot. Simulators that
+/// support detectors report the shots where it differs as detection events.
+inline void detector(const std::vector<std::int64_t> &lookbacks) {
+  getExecutionManager()->applyDetector(lookbacks);
+}
+
+/// @brief Include the parity of the measurements at the given lookbacks into
+/// the logical observable with the given index.
+inline void logical_observable(std::size_t index,
+                               const std::vector<std::int64_t> &lookbacks) {
+  getExecutionManager()->applyObservable(index, lookbacks);
+}
+
 } // namespace cudaq
 
 #define __qop__ __attribute__((annotate("user_custom_quantum_operation")))
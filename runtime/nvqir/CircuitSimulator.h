@@ -18,6 +18,8 @@
 #include "cudaq/host_config.h"
 #include <cstdarg>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <queue>
 #include <sstream>
 #include <string>
@@ -253,6 +255,22 @@ public:
                name());
   }
 
+  /// @brief Declare a detector: the parity of the measurements at the given
+  /// \p lookbacks into the measurement record, -1 being the latest one.
+  /// Only supported by simulators that report detection events.
+  virtual void addDetector(const std::vector<std::int64_t> &lookbacks) {
+    throw std::runtime_error("Detectors are not supported on the " + name() +
+                             " simulator.");
+  }
+
+  /// @brief Include the parity of the measurements at the given \p lookbacks
+  /// into the logical observable \p index.
+  virtual void addObservable(std::size_t index,
+                             const std::vector<std::int64_t> &lookbacks) {
+    throw std::runtime_error("Logical observables are not supported on the " +
+                             name() + " simulator.");
+  }
+
   /// @brief Apply a custom operation described by a matrix of data
   /// represented as 1-D vector of elements in row-major order, as well
   /// as the the control qubit and target indices
@@ -442,6 +460,26 @@ protected:
   /// deallocated at a later time.
   std::vector<std::size_t> deferredDeallocation;
 
+  /// @brief The computational basis state of each qubit id, for the qubits
+  /// known to be in one: after allocation, a reset or a measurement, and
+  /// through gates that map basis states to basis states (see
+  /// `trackBasisStates`).
+  std::vector<std::optional<bool>> qubitBasisStates;
+
+  /// @brief A qubit of the current execution context, in allocation order:
+  /// the id of a live qubit, or the basis state of a qubit released from the
+  /// state by `releaseDeallocatedQubits`.
+  struct RegisterSlot {
+    std::size_t qubitIdx;
+    std::optional<bool> releasedValue;
+  };
+
+  /// @brief The qubits allocated during the current execution context, once
+  /// one of them has been released. Released ids are reused by later
+  /// allocations, so this keeps the order in which the qubits would have been
+  /// numbered otherwise, see `restoreReleasedQubits`.
+  std::vector<RegisterSlot> registerSlots;
+
   /// @brief Map bit register names to the qubits that make it up
   std::unordered_map<std::string, std::vector<std::size_t>>
       registerNameToMeasuredQubit;
@@ -449,6 +487,44 @@ protected:
   /// @brief Keep track of the current number of qubits in batch mode
   std::size_t batchModeCurrentNumQubits = 0;
 
+  /// @brief A measurement branch: the outcomes of the measurements leading to
+  /// it and the number of shots assigned to it. For pending branches, the
+  /// subtype may have saved the state right before the last of these
+  /// measurements in slot `stateSlot`.
+  struct MeasurementBranch {
+    std::vector<bool> outcomes;
+    std::size_t shots = 0;
+    std::size_t stateSlot = 0;
+    bool hasSavedState = false;
+    /// @brief Fingerprint of the operations preceding the last measurement,
+    /// to check that the kernel replays them identically.
+    std::uint64_t fingerprint = 0;
+  };
+
+  /// @brief Branches still to be executed for `branchingContext`, executed
+  /// last in, first out.
+  std::vector<MeasurementBranch> pendingBranches;
+  const cudaq::ExecutionContext *branchingContext = nullptr;
+
+  /// @brief True if the current execution branches at measurements.
+  bool branchingMeasurements = false;
+
+  /// @brief True from the start of a branching execution until its execution
+  /// context is reset. Still set at the next start if the execution did not
+  /// complete, e.g., because the kernel threw.
+  bool branchExecutionUnfinished = false;
+
+  /// @brief The branch followed by the current execution. Its first
+  /// `numForcedOutcomes` outcomes were decided by earlier executions.
+  MeasurementBranch currentBranch;
+  std::size_t numForcedOutcomes = 0;
+  std::size_t branchMeasurementIndex = 0;
+
+  /// @brief True while the gates before the last forced measurement are
+  /// skipped because the state at that point was saved.
+  bool skippingBranchPrefix = false;
+  std::uint64_t branchFingerprint = 0;
+
   /// @brief Environment variable name that allows a programmer to
   /// specify how expectation values should be computed. This
   /// defaults to true.
@@ -485,7 +561,7 @@ protected:
     if (!executionContext)
       return 1;
     if (executionContext->hasConditionalsOnMeasureResults)
-      return 1;
+      return branchingMeasurements ? static_cast<int>(currentBranch.shots) : 1;
     if (executionContext->explicitMeasurements && !supportsBufferedSample)
       return 1;
     return static_cast<int>(executionContext->shots);
@@ -510,6 +586,174 @@ protected:
     deallocateStateImpl();
     nQubitsAllocated = 0;
     stateDimension = 0;
+    qubitBasisStates.clear();
+    registerSlots.clear();
+  }
+
+  /// @brief Remove qubit `qubitIdx`, the last qubit of the state, known to
+  /// be in the basis state |value>, from the state representation. Return
+  /// false, leaving the state unchanged, if the subtype does not support it
+  /// or cannot do it at this point.
+  virtual bool removeQubitFromState(std::size_t qubitIdx, bool value) {
+    return false;
+  }
+
+  /// @brief The basis state of qubit `qubitIdx`, if it is known.
+  std::optional<bool> basisState(std::size_t qubitIdx) const {
+    if (qubitIdx >= qubitBasisStates.size())
+      return std::nullopt;
+    return qubitBasisStates[qubitIdx];
+  }
+
+  void setBasisState(std::size_t qubitIdx, std::optional<bool> value) {
+    if (qubitIdx >= qubitBasisStates.size())
+      qubitBasisStates.resize(qubitIdx + 1);
+    qubitBasisStates[qubitIdx] = value;
+  }
+
+  /// @brief Update the known basis states for a gate being queued. Targets
+  /// in a basis state stay in one if the gate maps it to a single basis
+  /// state, and either always applies (all controls known to be |1>) or
+  /// leaves it unchanged.
+  void trackBasisStates(const std::vector<std::complex<ScalarType>> &matrix,
+                        const std::vector<std::size_t> &controls,
+                        const std::vector<std::size_t> &targets) {
+    bool controlsSet = true;
+    for (auto c : controls) {
+      const auto value = basisState(c);
+      // A control in |0> turns the gate into the identity.
+      if (value == false)
+        return;
+      controlsSet &= value == true;
+    }
+
+    // Noise channels follow the gates of a noise model.
+    bool targetsKnown = !(executionContext && executionContext->noiseModel);
+    std::size_t column = 0;
+    for (auto t : targets) {
+      const auto value = basisState(t);
+      targetsKnown &= value.has_value();
+      column = (column << 1) | (value == true);
+    }
+
+    const std::size_t dim = 1ULL << targets.size();
+    std::size_t numNonZeros = 0;
+    std::size_t row = 0;
+    if (targetsKnown)
+      for (std::size_t r = 0; r < dim; ++r)
+        if (matrix[r * dim + column] != std::complex<ScalarType>(0)) {
+          ++numNonZeros;
+          row = r;
+        }
+
+    const bool stayKnown = numNonZeros == 1 && (controlsSet || row == column);
+    for (std::size_t j = 0; j < targets.size(); ++j)
+      setBasisState(targets[j],
+                    stayKnown ? std::optional<bool>(
+                                    (row >> (targets.size() - 1 - j)) & 1)
+                              : std::nullopt);
+  }
+
+  /// @brief Remove deallocated qubits from the state during an execution
+  /// context. Deallocation is deferred until the end of the context, but a
+  /// qubit in a known basis state only multiplies the state dimension, so
+  /// it can be projected out right away. Only the last qubit of the state
+  /// can go without renumbering the others, so this stops at the first
+  /// qubit from the top that is still allocated, measured for the final
+  /// sampling, or not in a basis state. The released ids are returned to the
+  /// tracker for reuse.
+  void releaseDeallocatedQubits() {
+    if (isInTracerMode() || isInBatchMode() || branchingMeasurements ||
+        executionContext->noiseModel)
+      return;
+
+    while (nQubitsAllocated > 1) {
+      const std::size_t qubitIdx = nQubitsAllocated - 1;
+      const auto value = basisState(qubitIdx);
+      auto deferred = std::find(deferredDeallocation.begin(),
+                                deferredDeallocation.end(), qubitIdx);
+      if (!value || deferred == deferredDeallocation.end() ||
+          std::find(sampleQubits.begin(), sampleQubits.end(), qubitIdx) !=
+              sampleQubits.end() ||
+          !removeQubitFromState(qubitIdx, *value))
+        return;
+
+      cudaq::info("Releasing deallocated qubit {} from the state", qubitIdx);
+      if (registerSlots.empty())
+        for (std::size_t q = 0; q < nQubitsAllocated; ++q)
+          registerSlots.push_back({q, std::nullopt});
+      auto slot = std::find_if(
+          registerSlots.rbegin(), registerSlots.rend(), [&](const auto &s) {
+            return !s.releasedValue && s.qubitIdx == qubitIdx;
+          });
+      assert(slot != registerSlots.rend());
+      slot->releasedValue = value;
+
+      deferredDeallocation.erase(deferred);
+      tracker.returnIndex(qubitIdx);
+      --nQubitsAllocated;
+      stateDimension = calculateStateDim(nQubitsAllocated);
+    }
+  }
+
+  /// @brief Record newly allocated qubits of the current execution context,
+  /// if some of its qubits were released.
+  void addRegisterSlots(const std::vector<std::size_t> &qubits) {
+    if (registerSlots.empty())
+      return;
+    for (auto q : qubits)
+      registerSlots.push_back({q, std::nullopt});
+  }
+
+  /// @brief Add the qubits released by `releaseDeallocatedQubits` back to the
+  /// state in their basis states, and renumber all the qubits in allocation
+  /// order, as if none had been released. This is needed before reading the
+  /// whole register: implicit sampling of all the qubits, state extraction
+  /// and spin operator measurement.
+  void restoreReleasedQubits() {
+    if (registerSlots.empty())
+      return;
+
+    for (auto &slot : registerSlots) {
+      if (!slot.releasedValue)
+        continue;
+      slot.qubitIdx = tracker.getNextIndex();
+      assert(slot.qubitIdx == nQubitsAllocated);
+      previousStateDimension = stateDimension;
+      ++nQubitsAllocated;
+      stateDimension = calculateStateDim(nQubitsAllocated);
+      addQubitToState();
+      setBasisState(slot.qubitIdx, false);
+      if (*slot.releasedValue)
+        x(slot.qubitIdx);
+      deferredDeallocation.push_back(slot.qubitIdx);
+    }
+
+    // Move the qubit of slot `k` to id `k`.
+    const std::size_t numQubits = registerSlots.size();
+    assert(numQubits == nQubitsAllocated);
+    std::vector<std::size_t> idOf(numQubits), slotAt(numQubits);
+    std::vector<std::optional<bool>> values(numQubits);
+    for (std::size_t k = 0; k < numQubits; ++k) {
+      idOf[k] = registerSlots[k].qubitIdx;
+      slotAt[idOf[k]] = k;
+      values[k] = basisState(idOf[k]);
+    }
+    for (auto &q : deferredDeallocation)
+      q = slotAt[q];
+    for (std::size_t k = 0; k < numQubits; ++k) {
+      if (idOf[k] == k)
+        continue;
+      const std::size_t other = slotAt[k];
+      swap({}, k, idOf[k]);
+      idOf[other] = idOf[k];
+      slotAt[idOf[k]] = other;
+      idOf[k] = k;
+      slotAt[k] = k;
+    }
+    for (std::size_t k = 0; k < numQubits; ++k)
+      setBasisState(k, values[k]);
+    registerSlots.clear();
   }
 
   /// @brief Perform the actual mechanics of measuring a qubit,
@@ -624,6 +868,152 @@ protected:
     }
   }
 
+  /// @brief Return true if the subtype implements measurement branching, i.e.,
+  /// `splitShotsOnMeasurement` and `collapseQubit`. It may also save and
+  /// restore states to avoid simulating the operations leading to a branch
+  /// again.
+  virtual bool supportsMeasurementBranching() const { return false; }
+
+  /// @brief Return how many of `shots` shots measure 1 on the qubit, without
+  /// changing the state.
+  virtual std::size_t splitShotsOnMeasurement(const std::size_t qubitIdx,
+                                              const std::size_t shots) {
+    throw std::runtime_error("Measurement branching is not supported by the " +
+                             name() + " simulator.");
+  }
+
+  /// @brief Project the qubit onto `outcome` and renormalize the state. If
+  /// `resetToZero` is set, also flip the qubit back to |0>.
+  virtual void collapseQubit(const std::size_t qubitIdx, bool outcome,
+                             bool resetToZero) {
+    throw std::runtime_error("Measurement branching is not supported by the " +
+                             name() + " simulator.");
+  }
+
+  /// @brief Save a copy of the current state in `slot`. Return false if the
+  /// state was not saved, e.g., for lack of memory.
+  virtual bool saveBranchState(const std::size_t slot) { return false; }
+
+  /// @brief Replace the current state with the state saved in `slot`, and
+  /// free the slot.
+  virtual void restoreBranchState(const std::size_t slot) {
+    throw std::runtime_error("No saved state to restore.");
+  }
+
+  /// @brief Free all saved states.
+  virtual void clearBranchStates() {}
+
+  void mixBranchFingerprint(const void *data, std::size_t bytes) {
+    // FNV-1a
+    const auto *bytePtr = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < bytes; ++i)
+      branchFingerprint = (branchFingerprint ^ bytePtr[i]) * 0x100000001b3ULL;
+  }
+
+  template <typename T>
+  void mixBranchFingerprint(const std::vector<T> &data) {
+    const std::size_t size = data.size();
+    mixBranchFingerprint(&size, sizeof(size));
+    mixBranchFingerprint(data.data(), size * sizeof(T));
+  }
+
+  /// @brief Decide whether the execution that starts with the current
+  /// execution context branches at measurements, and which branch it follows.
+  ///
+  /// Kernels with conditionals on measurement results are otherwise executed
+  /// once per shot. With branching, a single execution carries a number of
+  /// shots; each measurement splits them binomially between its outcomes.
+  /// The execution follows the larger part, and the other part becomes a
+  /// pending branch, executed later by replaying the kernel with the outcomes
+  /// leading to it forced. Branches without shots are never executed, so the
+  /// number of executions is at most the number of distinct measurement
+  /// records, and usually much smaller than the number of shots.
+  void startMeasurementBranch() {
+    // The pending branches of an interrupted execution must not be followed
+    // by the next one, even if its execution context reuses the address of
+    // `branchingContext`.
+    if (branchExecutionUnfinished) {
+      pendingBranches.clear();
+      clearBranchStates();
+      branchingContext = nullptr;
+      skippingBranchPrefix = false;
+      branchExecutionUnfinished = false;
+    }
+
+    branchingMeasurements =
+        executionContext->allowMeasurementBranching &&
+        executionContext->name == "sample" &&
+        executionContext->hasConditionalsOnMeasureResults &&
+        !executionContext->noiseModel && supportsMeasurementBranching() &&
+        cudaq::getEnvBool("CUDAQ_MEASUREMENT_BRANCHING", true);
+    if (!branchingMeasurements)
+      return;
+
+    branchExecutionUnfinished = true;
+    if (branchingContext != executionContext) {
+      pendingBranches.clear();
+      clearBranchStates();
+      branchingContext = executionContext;
+    }
+    branchMeasurementIndex = 0;
+    branchFingerprint = 0xcbf29ce484222325ULL;
+    if (pendingBranches.empty()) {
+      currentBranch = MeasurementBranch{{}, executionContext->shots};
+    } else {
+      currentBranch = std::move(pendingBranches.back());
+      pendingBranches.pop_back();
+    }
+    numForcedOutcomes = currentBranch.outcomes.size();
+    skippingBranchPrefix = currentBranch.hasSavedState;
+    cudaq::info("Executing a measurement branch with {} shots ({} forced "
+                "outcomes, {} pending branches).",
+                currentBranch.shots, numForcedOutcomes,
+                pendingBranches.size());
+  }
+
+  /// @brief Measure the qubit (and reset it if `resetToZero` is set) in an
+  /// execution that branches at measurements. Return the outcome.
+  bool measureBranch(const std::size_t qubitIdx, bool resetToZero) {
+    const std::size_t index = branchMeasurementIndex++;
+    const std::size_t measureOp[] = {qubitIdx, resetToZero, nQubitsAllocated};
+    mixBranchFingerprint(measureOp, sizeof(measureOp));
+
+    bool outcome = false;
+    if (index < numForcedOutcomes) {
+      outcome = currentBranch.outcomes[index];
+      if (index + 1 == numForcedOutcomes && skippingBranchPrefix) {
+        if (branchFingerprint != currentBranch.fingerprint)
+          throw std::runtime_error(
+              "Measurement branching: the kernel did not replay the same "
+              "operations for the same measurement results. Set "
+              "CUDAQ_MEASUREMENT_BRANCHING=false to execute it shot by "
+              "shot.");
+        restoreBranchState(currentBranch.stateSlot);
+        skippingBranchPrefix = false;
+      }
+      if (!skippingBranchPrefix)
+        collapseQubit(qubitIdx, outcome, resetToZero);
+    } else {
+      const std::size_t shots = currentBranch.shots;
+      const std::size_t ones = splitShotsOnMeasurement(qubitIdx, shots);
+      outcome = 2 * ones >= shots;
+      const std::size_t otherShots = outcome ? shots - ones : ones;
+      if (otherShots > 0) {
+        MeasurementBranch other{currentBranch.outcomes, otherShots};
+        other.outcomes.push_back(!outcome);
+        other.fingerprint = branchFingerprint;
+        other.stateSlot = pendingBranches.size();
+        other.hasSavedState = saveBranchState(other.stateSlot);
+        pendingBranches.push_back(std::move(other));
+        currentBranch.shots -= otherShots;
+      }
+      currentBranch.outcomes.push_back(outcome);
+      collapseQubit(qubitIdx, outcome, resetToZero);
+    }
+    mixBranchFingerprint(&outcome, sizeof(outcome));
+    return outcome;
+  }
+
   /// @brief Utility function that returns a string-view of the current
   /// quantum instruction, intended for logging purposes.
   std::string gateToString(const std::string_view gateName,
@@ -798,6 +1188,8 @@ protected:
       return;
     }
 
+    trackBasisStates(matrix, controls, targets);
+
     // Use static variables to reduce the number of calls to cudaq::getEnvBool
     // since this is a frequently called piece of code, and we don't expect it
     // to change in the middle of a run.
@@ -830,11 +1222,166 @@ protected:
                                  const std::vector<std::size_t> &targets,
                                  const std::vector<double> &params) {}
 
+  /// @brief Maximum number of qubits a fused gate may act on. Gate fusion is
+  /// opt-in: it is disabled (0) unless a subclass sets this value.
+  std::size_t maxFusedQubits = 0;
+
+  /// @brief Return true if the current noise model attaches a channel to this
+  /// gate. Such gates are never fused so that their noise is still applied
+  /// right after them.
+  bool hasNoiseChannels(const GateApplicationTask &task) const {
+    if (!executionContext || !executionContext->noiseModel)
+      return false;
+    std::vector<double> params(task.parameters.begin(), task.parameters.end());
+    return !executionContext->noiseModel
+                ->get_channels(task.operationName, task.targets, task.controls,
+                               params)
+                .empty();
+  }
+
+  /// @brief Build the dense matrix of a run of gates acting within the
+  /// `qubits` block, honoring the simulator's qubit ordering convention for
+  /// both the input gate matrices and the output block matrix.
+  std::vector<std::complex<ScalarType>>
+  buildFusedMatrix(const std::vector<std::size_t> &qubits,
+                   const std::vector<const GateApplicationTask *> &gates) {
+    const std::size_t numQubits = qubits.size();
+    const std::size_t dim = 1ULL << numQubits;
+    const bool msb = getQubitOrdering() == QubitOrdering::msb;
+    // Bit of the block (or gate) matrix index holding the i-th qubit of n.
+    const auto bitOf = [msb](std::size_t i, std::size_t n) {
+      return msb ? n - 1 - i : i;
+    };
+    const auto blockBit = [&](std::size_t qubit) {
+      auto iter = std::find(qubits.begin(), qubits.end(), qubit);
+      return bitOf(std::distance(qubits.begin(), iter), numQubits);
+    };
+
+    // Start from the identity and left-multiply every gate, in order, by
+    // applying it to each column of the block matrix.
+    std::vector<std::complex<ScalarType>> fused(dim * dim, 0.0);
+    for (std::size_t i = 0; i < dim; ++i)
+      fused[i * dim + i] = 1.0;
+    std::vector<std::complex<ScalarType>> column(dim), in, out;
+    for (const auto *gate : gates) {
+      const std::size_t nTargets = gate->targets.size();
+      const std::size_t gateDim = 1ULL << nTargets;
+      std::size_t controlMask = 0, targetMask = 0;
+      for (auto c : gate->controls)
+        controlMask |= (1ULL << blockBit(c));
+      std::vector<std::size_t> offsets(gateDim, 0);
+      for (std::size_t j = 0; j < nTargets; ++j) {
+        const std::size_t bit = 1ULL << blockBit(gate->targets[j]);
+        targetMask |= bit;
+        for (std::size_t m = 0; m < gateDim; ++m)
+          if ((m >> bitOf(j, nTargets)) & 1)
+            offsets[m] |= bit;
+      }
+      in.resize(gateDim);
+      out.resize(gateDim);
+      for (std::size_t col = 0; col < dim; ++col) {
+        for (std::size_t row = 0; row < dim; ++row)
+          column[row] = fused[row * dim + col];
+        for (std::size_t base = 0; base < dim; ++base) {
+          if ((base & targetMask) || (base & controlMask) != controlMask)
+            continue;
+          for (std::size_t m = 0; m < gateDim; ++m)
+            in[m] = column[base | offsets[m]];
+          for (std::size_t r = 0; r < gateDim; ++r) {
+            out[r] = 0.0;
+            for (std::size_t m = 0; m < gateDim; ++m)
+              out[r] += gate->matrix[r * gateDim + m] * in[m];
+          }
+          for (std::size_t r = 0; r < gateDim; ++r)
+            column[base | offsets[r]] = out[r];
+        }
+        for (std::size_t row = 0; row < dim; ++row)
+          fused[row * dim + col] = column[row];
+      }
+    }
+    return fused;
+  }
+
+  /// @brief Gate fusion pass over the gate queue. Consecutive gates are
+  /// greedily merged into a single dense unitary as long as the union of the
+  /// qubits they act on (targets and controls) stays within `maxFusedQubits`.
+  /// Gate order is preserved, and gates carrying noise channels are left
+  /// untouched so that noise is inserted at the same points.
+  void fuseGateQueue() {
+    std::vector<GateApplicationTask> gates;
+    gates.reserve(gateQueue.size());
+    while (!gateQueue.empty()) {
+      gates.emplace_back(std::move(gateQueue.front()));
+      gateQueue.pop();
+    }
+
+    std::vector<std::size_t> blockQubits;
+    std::vector<const GateApplicationTask *> blockGates;
+    const auto flushBlock = [&]() {
+      if (blockGates.size() == 1) {
+        gateQueue.push(*blockGates.front());
+      } else if (!blockGates.empty()) {
+        CUDAQ_INFO("Fusing {} gates on qubits {}", blockGates.size(),
+                   blockQubits);
+        gateQueue.emplace("fused", buildFusedMatrix(blockQubits, blockGates),
+                          std::vector<std::size_t>{}, blockQubits,
+                          std::vector<ScalarType>{});
+      }
+      blockQubits.clear();
+      blockGates.clear();
+    };
+
+    const auto mergeQubits = [](std::vector<std::size_t> qubits,
+                                const GateApplicationTask &gate) {
+      for (const auto *operands : {&gate.controls, &gate.targets})
+        for (auto q : *operands)
+          if (std::find(qubits.begin(), qubits.end(), q) == qubits.end())
+            qubits.push_back(q);
+      return qubits;
+    };
+
+    for (const auto &gate : gates) {
+      if (hasNoiseChannels(gate)) {
+        flushBlock();
+        gateQueue.push(gate);
+        continue;
+      }
+      auto merged = mergeQubits(blockQubits, gate);
+      if (merged.size() > maxFusedQubits) {
+        // Close the current block and try to start a new one with this gate.
+        flushBlock();
+        merged = mergeQubits({}, gate);
+        if (merged.size() > maxFusedQubits) {
+          gateQueue.push(gate);
+          continue;
+        }
+      }
+      blockQubits = std::move(merged);
+      blockGates.push_back(&gate);
+    }
+    flushBlock();
+  }
+
   /// @brief Flush the gate queue, run all queued gate
   /// application tasks.
   void flushGateQueueImpl() override {
+    if (maxFusedQubits > 1 && gateQueue.size() > 1)
+      fuseGateQueue();
     while (!gateQueue.empty()) {
       auto &next = gateQueue.front();
+      if (branchingMeasurements) {
+        const std::size_t numQubits[] = {nQubitsAllocated};
+        mixBranchFingerprint(numQubits, sizeof(numQubits));
+        mixBranchFingerprint(next.matrix);
+        mixBranchFingerprint(next.controls);
+        mixBranchFingerprint(next.targets);
+        // The state after these gates was saved, it is restored at the
+        // measurement where this branch starts.
+        if (skippingBranchPrefix) {
+          gateQueue.pop();
+          continue;
+        }
+      }
       if (isStateVectorSimulator() && summaryData.enabled)
         summaryData.svGateUpdate(
             next.controls.size(), next.targets.size(), stateDimension,
@@ -918,6 +1465,8 @@ public:
   std::size_t allocateQubit() override {
     // Get a new qubit index
     auto newIdx = tracker.getNextIndex();
+    setBasisState(newIdx, false);
+    addRegisterSlots({newIdx});
     if (isInBatchMode()) {
       batchModeCurrentNumQubits++;
       // In batch mode, we might already have an allocated state that
@@ -971,8 +1520,12 @@ public:
     }
 
     std::vector<std::size_t> qubits;
-    for (std::size_t i = 0; i < count; i++)
+    for (std::size_t i = 0; i < count; i++) {
       qubits.emplace_back(tracker.getNextIndex());
+      setBasisState(qubits.back(), state ? std::nullopt
+                                         : std::optional<bool>(false));
+    }
+    addRegisterSlots(qubits);
 
     if (isInBatchMode()) {
       // Store the current number of qubits requested
@@ -1017,8 +1570,11 @@ public:
                                   "match the number of qubits");
 
     std::vector<std::size_t> qubits;
-    for (std::size_t i = 0; i < count; i++)
+    for (std::size_t i = 0; i < count; i++) {
       qubits.emplace_back(tracker.getNextIndex());
+      setBasisState(qubits.back(), std::nullopt);
+    }
+    addRegisterSlots(qubits);
 
     if (isInBatchMode()) {
       // Store the current number of qubits requested
@@ -1056,6 +1612,7 @@ public:
     if (executionContext && executionContext->name != "tracer") {
       cudaq::info("Deferring qubit {} deallocation", qubitIdx);
       deferredDeallocation.push_back(qubitIdx);
+      releaseDeallocatedQubits();
       return;
     }
 
@@ -1064,11 +1621,18 @@ public:
     // Reset the qubit
     if (!isInTracerMode())
       resetQubit(qubitIdx);
+    setBasisState(qubitIdx, false);
 
     // Return the index to the tracker
     tracker.returnIndex(qubitIdx);
     --nQubitsAllocated;
 
+    // The last qubit of the state can be dropped from it, a later allocation
+    // reuses its index.
+    if (!isInTracerMode() && qubitIdx == nQubitsAllocated &&
+        nQubitsAllocated > 0 && removeQubitFromState(qubitIdx, false))
+      stateDimension = calculateStateDim(nQubitsAllocated);
+
     // Reset the state if we've deallocated all qubits.
     if (tracker.allDeallocated()) {
       cudaq::info("Deallocated all qubits, reseting state vector.");
@@ -1092,6 +1656,7 @@ public:
         cudaq::info("Deferring qubit {} deallocation", qubitIdx);
         deferredDeallocation.push_back(qubitIdx);
       }
+      releaseDeallocatedQubits();
       return;
     }
 
@@ -1103,8 +1668,9 @@ public:
       return;
     }
 
-    for (auto &q : qubits)
-      deallocate(q);
+    // From the last qubit, so that each one can be dropped from the state.
+    for (auto q = qubits.rbegin(); q != qubits.rend(); ++q)
+      deallocate(*q);
   }
 
   /// @brief Reset the current execution context.
@@ -1120,6 +1686,7 @@ public:
     if (execContextName.find("sample") != std::string::npos) {
       // Sample the state over the specified number of shots
       if (sampleQubits.empty() && !executionContext->explicitMeasurements) {
+        restoreReleasedQubits();
         if (isInBatchMode())
           sampleQubits.resize(batchModeCurrentNumQubits);
         else
@@ -1134,9 +1701,20 @@ public:
       // Flush the queue if there are any gates to apply
       flushGateQueue();
 
+      if (skippingBranchPrefix) {
+        skippingBranchPrefix = false;
+        throw std::runtime_error(
+            "Measurement branching: the kernel did not replay the measurements "
+            "leading to this branch. Set CUDAQ_MEASUREMENT_BRANCHING=false to "
+            "execute it shot by shot.");
+      }
+
       // Flush any queued up sampling tasks
       flushAnySamplingTasks(/*force this*/ true);
 
+      // Every shot of a measurement branch has the same mid-circuit results.
+      const std::size_t midCircuitShots = getNumShotsToExec();
+
       // Handle the processing for any mid circuit measurements
       for (auto &m : midCircuitSampleResults) {
         // Get the register name and the vector of bit results
@@ -1151,12 +1729,12 @@ public:
           for (std::size_t j = 0; j < bitResults.size(); j++)
             bitStr += bitResults[j];
 
-          counts.appendResult(bitStr, 1);
+          counts.appendResult(bitStr, midCircuitShots);
 
         } else {
           // Not a vector, collate all bits into a 1 qubit counts dict
           for (std::size_t j = 0; j < bitResults.size(); j++) {
-            counts.appendResult(bitResults[j], 1);
+            counts.appendResult(bitResults[j], midCircuitShots);
           }
         }
         executionContext->result.append(counts);
@@ -1179,6 +1757,7 @@ public:
 
     // Set the state data if requested.
     if (executionContext->name == "extract-state") {
+      restoreReleasedQubits();
       flushGateQueue();
       executionContext->simulationState = getSimulationState();
     }
@@ -1190,6 +1769,8 @@ public:
 
     bool shouldSetToZero = isInBatchMode() && !isLastBatch();
     executionContext = nullptr;
+    branchingMeasurements = false;
+    branchExecutionUnfinished = false;
 
     // Reset the state if we've deallocated all qubits.
     if (tracker.allDeallocated()) {
@@ -1206,12 +1787,14 @@ public:
 
     batchModeCurrentNumQubits = 0;
     deferredDeallocation.clear();
+    registerSlots.clear();
   }
 
   /// @brief Set the execution context
   void setExecutionContext(cudaq::ExecutionContext *context) override {
     executionContext = context;
     executionContext->canHandleObserve = canHandleObserve();
+    startMeasurementBranch();
     currentCircuitName = context->kernelName;
     cudaq::info("Setting current circuit name to {}", currentCircuitName);
   }
@@ -1406,8 +1989,11 @@ public:
       return true;
 
     // Get the actual measurement from the subtype measureQubit implementation
-    auto measureResult = measureQubit(qubitIdx);
+    auto measureResult = branchingMeasurements
+                             ? measureBranch(qubitIdx, /*resetToZero=*/false)
+                             : measureQubit(qubitIdx);
     auto bitResult = measureResult == true ? "1" : "0";
+    setBasisState(qubitIdx, measureResult);
 
     // If this CUDA-Q kernel has conditional statements on measure results
     // then we want to handle the sampling a bit differently.
@@ -1421,6 +2007,7 @@ public:
   // this function explicitly received a vector of qubit indices such that
   // only the relative order of the target in the spin op is relevant.
   void measureSpinOp(const cudaq::spin_op &op) override {
+    restoreReleasedQubits();
     flushGateQueue();
 
     if (executionContext->canHandleObserve) {
@@ -804,6 +804,19 @@ void __quantum__qis__apply_kraus_channel_generalized(
   va_end(args);
 }
 
+void __quantum__qis__detector(const std::int64_t *lookbacks,
+                              std::size_t numLookbacks) {
+  nvqir::getCircuitSimulatorInternal()->addDetector(
+      std::vector<std::int64_t>(lookbacks, lookbacks + numLookbacks));
+}
+
+void __quantum__qis__observable_include(std::int64_t index,
+                                        const std::int64_t *lookbacks,
+                                        std::size_t numLookbacks) {
+  nvqir::getCircuitSimulatorInternal()->addObservable(
+      index, std::vector<std::int64_t>(lookbacks, lookbacks + numLookbacks));
+}
+
 namespace details {
 struct FakeQubit {
   std::int8_t *id;
@@ -0,0 +1,184 @@
+/****************************************************************-*- C++ -*-****
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#pragma once
+
+#include "QubitLayout.h"
+#include "StateVectorKernels.h"
+
+#include <functional>
+
+/// Cache-blocked application of a sequence of gates to a state vector.
+///
+/// Applying gates one at a time streams the whole state through the memory
+/// hierarchy once per gate. Gates whose targets are all low ("block") qubits
+/// of the amplitude index act independently on each block of
+/// `2^blockQubits` consecutive amplitudes, so a run of them can be applied to
+/// one block while it is in cache, with a single pass over the state for the
+/// whole run. The gates are split into phases whose targets fit in the block;
+/// before each phase, the qubits it targets are swapped into the block
+/// positions in one pass, and the resulting logical to physical qubit
+/// permutation is kept in a `QubitLayout` rather than undone.
+namespace nvqir::kernels {
+
+/// @brief Number of gates after a phase searched for the next use of a block
+/// qubit, when choosing which ones to swap out of the block.
+inline constexpr std::size_t blockingLookahead = 256;
+
+/// @brief Minimum number of blocks before the blocks of a run are split
+/// across OpenMP threads. With fewer blocks, the gate kernels parallelize
+/// within each block instead.
+inline constexpr std::size_t minParallelBlocks = 16;
+
+/// @brief Apply `gates` (anything with `matrix`, `controls` and `targets`, in
+/// logical qubits) to the `2^numQubits` amplitudes in `state`, whose qubits
+/// are placed according to `layout`. `prefetch(first, count)` is called with
+/// the amplitudes of each block shortly before they are used.
+template <typename ScalarType, typename GateTask, typename PrefetchFn>
+void applyGatesBlocked(std::complex<ScalarType> *state, std::size_t numQubits,
+                       std::size_t blockQubits, QubitLayout &layout,
+                       const std::vector<GateTask> &gates,
+                       PrefetchFn &&prefetch) {
+  assert(layout.size() == numQubits && numQubits < 64);
+  blockQubits = std::min(blockQubits, numQubits);
+  const std::size_t blockSize = 1ULL << blockQubits;
+  const std::size_t numBlocks = 1ULL << (numQubits - blockQubits);
+
+  const auto targetMask = [](const GateTask &gate) {
+    std::uint64_t mask = 0;
+    for (auto t : gate.targets)
+      mask |= 1ULL << t;
+    return mask;
+  };
+
+  const auto applyDirect = [&](const GateTask &gate) {
+    std::vector<std::size_t> controls, targets;
+    for (auto c : gate.controls)
+      controls.push_back(layout.physical(c));
+    for (auto t : gate.targets)
+      targets.push_back(layout.physical(t));
+    applyGate(state, numQubits, gate.matrix.data(), controls, targets);
+  };
+
+  // A gate of a phase, on the physical positions within a block. Controls
+  // above the block select the blocks the gate applies to.
+  struct BlockGate {
+    const std::complex<ScalarType> *matrix;
+    std::vector<std::size_t> controls;
+    std::vector<std::size_t> targets;
+    std::size_t blockControlMask = 0;
+  };
+
+  // Apply `gates[first, last)`, all targeting block qubits, block by block.
+  const auto applyRun = [&](std::size_t first, std::size_t last) {
+    std::vector<BlockGate> run;
+    for (std::size_t g = first; g < last; ++g) {
+      BlockGate blockGate{gates[g].matrix.data()};
+      for (auto t : gates[g].targets)
+        blockGate.targets.push_back(layout.physical(t));
+      for (auto c : gates[g].controls) {
+        const std::size_t position = layout.physical(c);
+        if (position < blockQubits)
+          blockGate.controls.push_back(position);
+        else
+          blockGate.blockControlMask |= 1ULL << position;
+      }
+      run.push_back(std::move(blockGate));
+    }
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numBlocks >= minParallelBlocks)
+#endif
+    for (std::size_t block = 0; block < numBlocks; ++block) {
+      if (block + 1 < numBlocks)
+        prefetch((block + 1) * blockSize, blockSize);
+      const std::size_t base = block * blockSize;
+      for (const auto &gate : run)
+        if ((base & gate.blockControlMask) == gate.blockControlMask)
+          applyGate(state + base, blockQubits, gate.matrix, gate.controls,
+                    gate.targets);
+    }
+  };
+
+  for (std::size_t g = 0; g < gates.size();) {
+    // The phase is the longest run of gates whose targets fit in the block.
+    std::uint64_t needed = 0;
+    std::size_t end = g;
+    for (; end < gates.size(); ++end) {
+      const std::uint64_t mask = needed | targetMask(gates[end]);
+      if (static_cast<std::size_t>(std::popcount(mask)) > blockQubits)
+        break;
+      needed = mask;
+    }
+
+    std::vector<std::size_t> incoming;
+    for (std::size_t q = 0; q < numQubits; ++q)
+      if (((needed >> q) & 1) && layout.physical(q) >= blockQubits)
+        incoming.push_back(q);
+
+    // A gate on more qubits than the block, or a single gate that would need
+    // a swap first, is cheaper applied on its own.
+    if (end == g || (!incoming.empty() && end - g < 2)) {
+      applyDirect(gates[g]);
+      ++g;
+      continue;
+    }
+
+    if (!incoming.empty()) {
+      // Swap out the block qubits the phase does not need, the ones used
+      // again the latest first.
+      std::vector<std::pair<std::size_t, std::size_t>> candidates;
+      for (std::size_t p = 0; p < blockQubits; ++p) {
+        const std::size_t q = layout.logical(p);
+        if ((needed >> q) & 1)
+          continue;
+        std::size_t nextUse = end;
+        const std::size_t horizon =
+            std::min(gates.size(), end + blockingLookahead);
+        while (nextUse < horizon && !((targetMask(gates[nextUse]) >> q) & 1))
+          ++nextUse;
+        candidates.emplace_back(nextUse, p);
+      }
+      std::sort(candidates.begin(), candidates.end(), std::greater<>());
+
+      std::vector<std::pair<std::size_t, std::size_t>> swaps;
+      for (std::size_t k = 0; k < incoming.size(); ++k)
+        swaps.emplace_back(layout.physical(incoming[k]), candidates[k].second);
+      swapQubits(state, numQubits, swaps);
+      for (auto [a, b] : swaps)
+        layout.swapPositions(a, b);
+    }
+
+    applyRun(g, end);
+    g = end;
+  }
+}
+
+/// @brief Put the qubits of the `2^numQubits` amplitudes in `state`, placed
+/// according to `layout`, back in the CUDA-Q order.
+template <typename ScalarType>
+void restoreQubitOrder(std::complex<ScalarType> *state, std::size_t numQubits,
+                       QubitLayout &layout) {
+  // Each pass moves at least one qubit home, usually all of them.
+  while (!layout.isIdentity()) {
+    std::uint64_t used = 0;
+    std::vector<std::pair<std::size_t, std::size_t>> swaps;
+    for (std::size_t q = 0; q < numQubits; ++q) {
+      const std::size_t position = layout.physical(q);
+      const std::uint64_t bits = (1ULL << q) | (1ULL << position);
+      if (position == q || (used & bits))
+        continue;
+      swaps.emplace_back(q, position);
+      used |= bits;
+    }
+    swapQubits(state, numQubits, swaps);
+    for (auto [a, b] : swaps)
+      layout.swapPositions(a, b);
+  }
+}
+
+} // namespace nvqir::kernels
@@ -0,0 +1,570 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#define __NVQIR_QPP_TOGGLE_CREATE
+#include "QppCircuitSimulator.cpp"
+#undef __NVQIR_QPP_TOGGLE_CREATE
+
+#include <unordered_map>
+
+namespace {
+
+/// @brief A group of qubits that may be entangled with each other, but not
+/// with any other qubit, and their state vector. Bit `b` of the amplitude
+/// index is the qubit `qubits[b]`.
+struct QubitFactor {
+  std::vector<std::size_t> qubits;
+  qpp::ket state;
+};
+
+/// @brief A single qubit in the basis state |0> or |1>.
+QubitFactor basisFactor(std::size_t qubit, bool one) {
+  QubitFactor factor{{qubit}, qpp::ket::Zero(2)};
+  factor.state(one ? 1 : 0) = 1.0;
+  return factor;
+}
+
+/// @brief Amplitude of the product of `factors` for the basis state whose
+/// value for qubit `q` is `bit(q)`.
+template <typename BitFn>
+std::complex<double> productAmplitude(const std::vector<QubitFactor> &factors,
+                                      BitFn &&bit) {
+  std::complex<double> amplitude = 1.0;
+  for (const auto &factor : factors) {
+    std::size_t index = 0;
+    for (std::size_t b = 0; b < factor.qubits.size(); ++b)
+      index |= static_cast<std::size_t>(bit(factor.qubits[b]) != 0) << b;
+    amplitude *= factor.state(index);
+  }
+  return amplitude;
+}
+
+/// @brief `SimulationState` of the factored simulator: the tensor product of
+/// its factors. Amplitudes are computed from the factors, so they can be
+/// queried on states too wide to be stored as a single vector; the full state
+/// vector is only built when it is accessed as a tensor.
+struct FactoredState : public cudaq::SimulationState {
+  std::vector<QubitFactor> factors;
+  std::size_t numQubits = 0;
+
+  /// @brief The full state vector, built on first use.
+  mutable qpp::ket amplitudes;
+
+  FactoredState(std::vector<QubitFactor> &&factors, std::size_t numQubits)
+      : factors(std::move(factors)), numQubits(numQubits) {}
+
+  const qpp::ket &stateVector() const {
+    if (amplitudes.size() != 0 || numQubits == 0)
+      return amplitudes;
+    if (numQubits >= 64)
+      throw std::runtime_error(fmt::format(
+          "[qpp-factored] The state of {} qubits is too large to be stored "
+          "as a vector. Use getAmplitude to query it.",
+          numQubits));
+    const std::size_t dim = 1ULL << numQubits;
+    amplitudes.resize(dim);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (dim >= nvqir::kernels::minParallelWork)
+#endif
+    for (std::size_t i = 0; i < dim; ++i)
+      amplitudes(i) = productAmplitude(
+          factors, [i](std::size_t q) { return (i >> q) & 1; });
+    return amplitudes;
+  }
+
+  std::size_t getNumQubits() const override { return numQubits; }
+
+  std::complex<double> overlap(const cudaq::SimulationState &other) override {
+    if (other.getNumTensors() != 1 ||
+        (other.getTensor().extents != getTensor().extents))
+      throw std::runtime_error(
+          "[qpp-factored] overlap error - other state dimension not equal to "
+          "this state dimension.");
+
+    if (other.getPrecision() != getPrecision())
+      throw std::runtime_error(
+          "[qpp-factored] overlap error - other state precision not equal to "
+          "this state precision.");
+
+    const auto &state = stateVector();
+    const auto *otherState =
+        reinterpret_cast<std::complex<double> *>(other.getTensor().data);
+    return std::abs(nvqir::kernels::innerProduct(
+        state.data(), otherState, static_cast<std::size_t>(state.size())));
+  }
+
+  std::complex<double>
+  getAmplitude(const std::vector<int> &basisState) override {
+    if (getNumQubits() != basisState.size())
+      throw std::runtime_error(fmt::format(
+          "[qpp-factored] getAmplitude with an invalid number of bits in the "
+          "basis state: expected {}, provided {}.",
+          getNumQubits(), basisState.size()));
+    if (std::any_of(basisState.begin(), basisState.end(),
+                    [](int x) { return x != 0 && x != 1; }))
+      throw std::runtime_error(
+          "[qpp-factored] getAmplitude with an invalid basis state: only "
+          "qubit state (0 or 1) is supported.");
+
+    return productAmplitude(
+        factors, [&basisState](std::size_t q) { return basisState[q]; });
+  }
+
+  Tensor getTensor(std::size_t tensorIdx = 0) const override {
+    if (tensorIdx != 0)
+      throw std::runtime_error("[qpp-factored] invalid tensor requested.");
+    const auto &state = stateVector();
+    return Tensor{reinterpret_cast<void *>(
+                      const_cast<std::complex<double> *>(state.data())),
+                  std::vector<std::size_t>{static_cast<std::size_t>(
+                      state.size())},
+                  getPrecision()};
+  }
+
+  std::vector<Tensor> getTensors() const override { return {getTensor()}; }
+
+  std::size_t getNumTensors() const override { return 1; }
+
+  std::complex<double>
+  operator()(std::size_t tensorIdx,
+             const std::vector<std::size_t> &indices) override {
+    if (tensorIdx != 0)
+      throw std::runtime_error("[qpp-factored] invalid tensor requested.");
+    if (indices.size() != 1)
+      throw std::runtime_error("[qpp-factored] invalid element extraction.");
+
+    const std::size_t index = indices[0];
+    return productAmplitude(
+        factors, [index](std::size_t q) { return q < 64 && (index >> q) & 1; });
+  }
+
+  std::unique_ptr<SimulationState>
+  createFromSizeAndPtr(std::size_t size, void *ptr, std::size_t) override {
+    QubitFactor factor;
+    factor.qubits.resize(std::countr_zero(size));
+    std::iota(factor.qubits.begin(), factor.qubits.end(), 0);
+    factor.state =
+        qpp::ket::Map(reinterpret_cast<std::complex<double> *>(ptr), size);
+    const std::size_t numQubits = factor.qubits.size();
+    std::vector<QubitFactor> factors;
+    factors.push_back(std::move(factor));
+    return std::make_unique<FactoredState>(std::move(factors), numQubits);
+  }
+
+  void dump(std::ostream &os) const override { os << stateVector() << "\n"; }
+
+  precision getPrecision() const override {
+    return cudaq::SimulationState::precision::fp64;
+  }
+
+  void destroyState() override {
+    factors.clear();
+    amplitudes = qpp::ket();
+  }
+};
+
+/// @brief A CPU state vector simulator that keeps the state as a tensor
+/// product of independent factors, one state vector per group of possibly
+/// entangled qubits (see `QubitFactor`).
+///
+/// Qubits start in factors of their own, and factors are only merged when a
+/// gate acts on qubits of several of them, so the memory and time spent on a
+/// circuit grow with its largest entangled group rather than with its total
+/// width. A measured or reset qubit is no longer entangled with the rest of
+/// its factor and is split off into a factor of its own again. Sampling,
+/// expectation values and amplitudes are computed factor by factor.
+///
+/// Gates are applied with the same native kernels as `qpp-cpu`, on the state
+/// vector of one factor at a time.
+class FactoredCircuitSimulator : public nvqir::CircuitSimulatorBase<double> {
+protected:
+  using Amplitude = std::complex<double>;
+
+  std::vector<QubitFactor> factors;
+
+  /// @brief The factor of each qubit, and its bit position in that factor.
+  std::vector<std::size_t> factorOf;
+  std::vector<std::size_t> positionOf;
+
+  /// @brief The state is never stored as a single vector, so the number of
+  /// qubits is not limited by the size of the amplitude index.
+  std::size_t calculateStateDim(const std::size_t numQubits) override {
+    return numQubits < 64 ? 1ULL << numQubits
+                          : std::numeric_limits<std::size_t>::max();
+  }
+
+  void indexFactor(std::size_t f) {
+    const auto &qubits = factors[f].qubits;
+    for (std::size_t b = 0; b < qubits.size(); ++b) {
+      factorOf[qubits[b]] = f;
+      positionOf[qubits[b]] = b;
+    }
+  }
+
+  void appendFactor(QubitFactor &&factor) {
+    factors.push_back(std::move(factor));
+    indexFactor(factors.size() - 1);
+  }
+
+  /// @brief Merge the factors of `qubits` into a single one and return its
+  /// index.
+  std::size_t mergeFactors(const std::vector<std::size_t> &qubits) {
+    std::vector<std::size_t> involved;
+    for (auto q : qubits)
+      involved.push_back(factorOf[q]);
+    std::sort(involved.begin(), involved.end());
+    involved.erase(std::unique(involved.begin(), involved.end()),
+                   involved.end());
+    if (involved.size() == 1)
+      return involved.front();
+
+    // Grow the largest factor with the others, so the fewest amplitudes move.
+    const auto largest = *std::max_element(
+        involved.begin(), involved.end(), [this](std::size_t a, std::size_t b) {
+          return factors[a].qubits.size() < factors[b].qubits.size();
+        });
+    QubitFactor merged = std::move(factors[largest]);
+    for (auto f : involved) {
+      if (f == largest)
+        continue;
+      const auto &other = factors[f];
+      if (merged.qubits.size() + other.qubits.size() >= 64)
+        throw std::runtime_error(fmt::format(
+            "[qpp-factored] A gate entangles more than {} qubits, which "
+            "exceeds the size of a state vector.",
+            merged.qubits.size() + other.qubits.size()));
+      const std::size_t oldDim = merged.state.size();
+      merged.state.conservativeResize(oldDim * other.state.size());
+      nvqir::kernels::growState(merged.state.data(), oldDim,
+                                other.state.data(), other.state.size());
+      merged.qubits.insert(merged.qubits.end(), other.qubits.begin(),
+                           other.qubits.end());
+    }
+
+    // Removing the highest indices first only moves factors that are kept.
+    for (auto f = involved.rbegin(); f != involved.rend(); ++f) {
+      if (*f + 1 != factors.size())
+        factors[*f] = std::move(factors.back());
+      factors.pop_back();
+      if (*f < factors.size())
+        indexFactor(*f);
+    }
+    appendFactor(std::move(merged));
+    return factors.size() - 1;
+  }
+
+  void addQubitToState() override { addQubitsToState(1); }
+
+  void addQubitsToState(std::size_t qubitCount,
+                        const void *stateDataIn = nullptr) override {
+    if (qubitCount == 0)
+      return;
+
+    const std::size_t first = factorOf.size();
+    factorOf.resize(first + qubitCount);
+    positionOf.resize(first + qubitCount);
+    if (!stateDataIn) {
+      for (std::size_t q = first; q < first + qubitCount; ++q)
+        appendFactor(basisFactor(q, false));
+      return;
+    }
+
+    QubitFactor factor;
+    factor.qubits.resize(qubitCount);
+    std::iota(factor.qubits.begin(), factor.qubits.end(), first);
+    factor.state = qpp::ket::Map(
+        reinterpret_cast<const Amplitude *>(stateDataIn), 1ULL << qubitCount);
+    appendFactor(std::move(factor));
+  }
+
+  void addQubitsToState(const cudaq::SimulationState &in_state) override {
+    if (const auto *casted = dynamic_cast<const FactoredState *>(&in_state)) {
+      const std::size_t first = factorOf.size();
+      factorOf.resize(first + casted->getNumQubits());
+      positionOf.resize(first + casted->getNumQubits());
+      for (const auto &factor : casted->factors) {
+        QubitFactor copy = factor;
+        for (auto &q : copy.qubits)
+          q += first;
+        appendFactor(std::move(copy));
+      }
+      return;
+    }
+    const auto *const casted =
+        dynamic_cast<const nvqir::QppState<double> *>(&in_state);
+    if (!casted)
+      throw std::invalid_argument(
+          "[FactoredCircuitSimulator] Incompatible state input");
+    addQubitsToState(casted->getNumQubits(), casted->state.data());
+  }
+
+  void deallocateStateImpl() override {
+    factors.clear();
+    factorOf.clear();
+    positionOf.clear();
+  }
+
+  void setToZeroState() override {
+    factors.clear();
+    for (std::size_t q = 0; q < factorOf.size(); ++q)
+      appendFactor(basisFactor(q, false));
+  }
+
+  void applyGate(const GateApplicationTask &task) override {
+    // A control in a known basis state either always or never enables the
+    // gate, and does not need to be merged with the targets.
+    std::vector<std::size_t> qubits;
+    for (auto c : task.controls) {
+      const auto &factor = factors[factorOf[c]];
+      if (factor.qubits.size() == 1 && factor.state(1) == 0.0)
+        return;
+      if (factor.qubits.size() == 1 && factor.state(0) == 0.0)
+        continue;
+      qubits.push_back(c);
+    }
+    const std::size_t numControls = qubits.size();
+    qubits.insert(qubits.end(), task.targets.begin(), task.targets.end());
+
+    auto &factor = factors[mergeFactors(qubits)];
+    std::vector<std::size_t> controls, targets;
+    for (std::size_t k = 0; k < qubits.size(); ++k)
+      (k < numControls ? controls : targets).push_back(positionOf[qubits[k]]);
+    nvqir::kernels::applyGate(factor.state.data(), factor.qubits.size(),
+                              task.matrix.data(), controls, targets);
+  }
+
+  /// @brief Measure the qubit and split it off from its factor. If
+  /// `resetToZero` is set, it is left in |0> rather than in the measured
+  /// state.
+  bool measure(const std::size_t qubit, bool resetToZero) {
+    const std::size_t f = factorOf[qubit];
+    const std::size_t position = positionOf[qubit];
+    auto &factor = factors[f];
+    const std::size_t numQubits = factor.qubits.size();
+    const double probOne =
+        std::clamp(nvqir::kernels::probabilityOfOne(factor.state.data(),
+                                                    numQubits, position),
+                   0.0, 1.0);
+    std::discrete_distribution<int> outcomeDistribution{1.0 - probOne,
+                                                        probOne};
+    const bool result =
+        outcomeDistribution(qpp::RandomDevices::get_instance().get_prng()) ==
+        1;
+    if (numQubits == 1) {
+      factor = basisFactor(qubit, result && !resetToZero);
+      return result;
+    }
+
+    // The other qubits of the factor keep the amplitudes of the outcome.
+    const double outcomeProb = result ? probOne : 1.0 - probOne;
+    const double scale = 1.0 / std::sqrt(outcomeProb);
+    const std::size_t insertMask = (1ULL << position) - 1;
+    const std::size_t outcomeBit = result ? (1ULL << position) : 0;
+    const std::size_t restDim = 1ULL << (numQubits - 1);
+    QubitFactor rest;
+    rest.qubits = factor.qubits;
+    rest.qubits.erase(rest.qubits.begin() + position);
+    rest.state.resize(restDim);
+    const Amplitude *data = factor.state.data();
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (restDim >= nvqir::kernels::minParallelWork)
+#endif
+    for (std::size_t i = 0; i < restDim; ++i)
+      rest.state(i) =
+          data[nvqir::kernels::insertZeroBits(i, &insertMask, 1) | outcomeBit] *
+          scale;
+
+    factors[f] = std::move(rest);
+    indexFactor(f);
+    appendFactor(basisFactor(qubit, result && !resetToZero));
+    return result;
+  }
+
+  bool measureQubit(const std::size_t index) override {
+    const bool result = measure(index, /*resetToZero=*/false);
+    cudaq::info("Measured qubit {} -> {}", index, result);
+    return result;
+  }
+
+  /// @brief Expectation values of Pauli strings, given by their masks on the
+  /// bit positions of factor `f`.
+  std::vector<double>
+  factorExpectations(std::size_t f,
+                     const std::vector<nvqir::kernels::PauliMasks> &masks) {
+    const auto *data = factors[f].state.data();
+    return nvqir::kernels::pauliExpectations(
+        [data](std::size_t i, std::size_t x) {
+          return nvqir::kernels::cmul(std::conj(data[i ^ x]), data[i]);
+        },
+        factors[f].qubits.size(), masks);
+  }
+
+public:
+  FactoredCircuitSimulator() { summaryData.name = name(); }
+  virtual ~FactoredCircuitSimulator() = default;
+
+  void setRandomSeed(std::size_t seed) override {
+    qpp::RandomDevices::get_instance().get_prng().seed(seed);
+  }
+
+  bool canHandleObserve() override {
+    // Do not compute <H> from matrix if shots based sampling requested
+    if (executionContext &&
+        executionContext->shots != static_cast<std::size_t>(-1))
+      return false;
+    return !shouldObserveFromSampling();
+  }
+
+  cudaq::observe_result observe(const cudaq::spin_op &op) override {
+    assert(cudaq::spin_op::canonicalize(op) == op);
+    flushGateQueue();
+
+    // Each term is a product of Pauli strings on the factors, and so is its
+    // expectation value. The strings are evaluated per factor, in one batch.
+    std::vector<std::vector<nvqir::kernels::PauliMasks>> factorMasks(
+        factors.size());
+    std::vector<std::vector<std::pair<std::size_t, std::size_t>>> termParts;
+    std::vector<std::complex<double>> coefficients;
+    for (const auto &term : op) {
+      std::map<std::size_t, nvqir::kernels::PauliMasks> parts;
+      for (const auto &p : term) {
+        const auto pauli = p.as_pauli();
+        if (pauli == cudaq::pauli::I)
+          continue;
+        const std::size_t target = p.target();
+        if (target >= factorOf.size())
+          throw std::runtime_error(fmt::format(
+              "observe: operator acts on qubit {} but the state only has {} "
+              "qubits",
+              target, factorOf.size()));
+        auto &masks = parts[factorOf[target]];
+        const std::size_t bit = 1ULL << positionOf[target];
+        if (pauli != cudaq::pauli::Z)
+          masks.x |= bit;
+        if (pauli != cudaq::pauli::X)
+          masks.z |= bit;
+        if (pauli == cudaq::pauli::Y)
+          ++masks.numY;
+      }
+      auto &termPart = termParts.emplace_back();
+      for (const auto &[f, masks] : parts) {
+        termPart.emplace_back(f, factorMasks[f].size());
+        factorMasks[f].push_back(masks);
+      }
+      coefficients.push_back(term.evaluate_coefficient());
+    }
+
+    std::vector<std::vector<double>> factorValues(factors.size());
+    for (std::size_t f = 0; f < factors.size(); ++f)
+      if (!factorMasks[f].empty())
+        factorValues[f] = factorExpectations(f, factorMasks[f]);
+    double ee = 0.0;
+    for (std::size_t t = 0; t < termParts.size(); ++t) {
+      double termValue = 1.0;
+      for (auto [f, index] : termParts[t])
+        termValue *= factorValues[f][index];
+      ee += (coefficients[t] * termValue).real();
+    }
+
+    return cudaq::observe_result(
+        ee, op,
+        cudaq::sample_result(cudaq::ExecutionResult({}, op.to_string(), ee)));
+  }
+
+  void resetQubit(const std::size_t index) override {
+    flushGateQueue();
+    flushAnySamplingTasks();
+    measure(index, /*resetToZero=*/true);
+  }
+
+  cudaq::ExecutionResult sample(const std::vector<std::size_t> &qubits,
+                                const int shots) override {
+    flushGateQueue();
+
+    // The positions in `qubits` of the measured qubits of each factor.
+    std::map<std::size_t, std::vector<std::size_t>> measuredBits;
+    for (std::size_t b = 0; b < qubits.size(); ++b)
+      measuredBits[factorOf[qubits[b]]].push_back(b);
+
+    if (shots < 1) {
+      double expectationValue = 1.0;
+      for (const auto &[f, bits] : measuredBits) {
+        nvqir::kernels::PauliMasks zMask;
+        for (auto b : bits)
+          zMask.z |= 1ULL << positionOf[qubits[b]];
+        expectationValue *= factorExpectations(f, {zMask})[0];
+      }
+      cudaq::info("Computed expectation value = {}", expectationValue);
+      return cudaq::ExecutionResult{{}, expectationValue};
+    }
+
+    // The factors are independent: sample each of them on its own, and pair
+    // up their outcomes at random.
+    auto &gen = qpp::RandomDevices::get_instance().get_prng();
+    std::vector<std::string> outcomes(measuredBits.size() == 1 ? 0 : shots,
+                                      std::string(qubits.size(), '0'));
+    for (const auto &[f, bits] : measuredBits) {
+      std::vector<std::size_t> positions;
+      for (auto b : bits)
+        positions.push_back(positionOf[qubits[b]]);
+      const auto *data = factors[f].state.data();
+      const auto sampleResult = nvqir::kernels::sampleOutcomes(
+          [data](std::size_t i) { return std::norm(data[i]); },
+          factors[f].qubits.size(), positions, shots, gen);
+      if (outcomes.empty())
+        return nvqir::toExecutionResult(sampleResult, qubits.size(), shots);
+
+      std::vector<std::uint64_t> keys;
+      keys.reserve(shots);
+      for (auto [key, count] : sampleResult)
+        keys.insert(keys.end(), count, key);
+      std::shuffle(keys.begin(), keys.end(), gen);
+      for (std::size_t shot = 0; shot < keys.size(); ++shot)
+        for (std::size_t k = 0; k < bits.size(); ++k)
+          if ((keys[shot] >> k) & 1)
+            outcomes[shot][bits[k]] = '1';
+    }
+
+    std::unordered_map<std::string, std::size_t> counts;
+    for (auto &outcome : outcomes)
+      ++counts[std::move(outcome)];
+    cudaq::ExecutionResult result;
+    double expVal = 0.0;
+    for (const auto &[bitstring, count] : counts) {
+      result.appendResult(bitstring, count);
+      const auto p = count / static_cast<double>(shots);
+      expVal += std::count(bitstring.begin(), bitstring.end(), '1') % 2 ? -p
+                                                                          : p;
+    }
+    result.expectationValue = expVal;
+    return result;
+  }
+
+  /// @brief Export the state. Its amplitudes are computed from the factors,
+  /// which are moved into it.
+  std::unique_ptr<cudaq::SimulationState> getSimulationState() override {
+    flushGateQueue();
+    const std::size_t numQubits = factorOf.size();
+    factorOf.clear();
+    positionOf.clear();
+    return std::make_unique<FactoredState>(std::move(factors), numQubits);
+  }
+
+  bool isStateVectorSimulator() const override { return true; }
+
+  std::string name() const override { return "qpp-factored"; }
+
+  NVQIR_SIMULATOR_CLONE_IMPL(FactoredCircuitSimulator)
+};
+
+} // namespace
+
+/// Register this Simulator with NVQIR.
+NVQIR_REGISTER_SIMULATOR(FactoredCircuitSimulator, qpp_factored)
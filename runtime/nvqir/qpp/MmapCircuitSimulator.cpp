@@ -0,0 +1,383 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#define __NVQIR_QPP_TOGGLE_CREATE
+#include "QppCircuitSimulator.cpp"
+#undef __NVQIR_QPP_TOGGLE_CREATE
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+/// @brief A state vector stored in a memory-mapped file rather than in
+/// memory, so that its size is only limited by the file system. The kernel
+/// pages amplitudes in and out as they are accessed; on a local SSD this lets
+/// a node simulate states larger than its memory.
+///
+/// The file is unlinked as soon as it is created, so it never outlives the
+/// simulator, even if the process is killed.
+class MappedStateFile {
+  using Amplitude = std::complex<double>;
+
+  int fd = -1;
+  void *mapping = nullptr;
+  std::size_t mappedBytes = 0;
+
+  void unmap() {
+    if (mapping)
+      munmap(mapping, mappedBytes);
+    mapping = nullptr;
+    mappedBytes = 0;
+  }
+
+  [[noreturn]] static void fail(const std::string &what) {
+    throw std::runtime_error(
+        fmt::format("[qpp-mmap] {}: {}", what, std::strerror(errno)));
+  }
+
+public:
+  MappedStateFile() = default;
+  MappedStateFile(const MappedStateFile &) = delete;
+  MappedStateFile &operator=(const MappedStateFile &) = delete;
+  ~MappedStateFile() { close(); }
+
+  Amplitude *data() const { return static_cast<Amplitude *>(mapping); }
+
+  /// @brief Number of amplitudes.
+  std::size_t size() const { return mappedBytes / sizeof(Amplitude); }
+
+  /// @brief Resize to `size` amplitudes, creating the file in `directory` if
+  /// needed. Existing amplitudes are kept, new ones are zero.
+  void resize(const std::string &directory, std::size_t size) {
+    if (fd < 0) {
+      std::string path =
+          (std::filesystem::path(directory) / "cudaq-state-XXXXXX").string();
+      fd = mkstemp(path.data());
+      if (fd < 0)
+        fail(fmt::format("Failed to create a state file in '{}'", directory));
+      unlink(path.c_str());
+    }
+
+    // Extending the file leaves a hole that reads as zeros and takes no
+    // space until it is written.
+    const std::size_t bytes = size * sizeof(Amplitude);
+    if (ftruncate(fd, bytes) != 0)
+      fail(fmt::format("Failed to resize the state file to {} bytes", bytes));
+    unmap();
+    void *newMapping =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (newMapping == MAP_FAILED)
+      fail("Failed to map the state file");
+    mapping = newMapping;
+    mappedBytes = bytes;
+  }
+
+  /// @brief Set all amplitudes to zero by dropping the file contents.
+  void clear() {
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, mappedBytes) != 0)
+      fail("Failed to clear the state file");
+  }
+
+  /// @brief Hint that amplitudes `[first, first + count)` will be accessed
+  /// soon, so that reading them from the file overlaps with computation.
+  void prefetch(std::size_t first, std::size_t count) const {
+    static const auto pageSize =
+        static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const auto begin = (first * sizeof(Amplitude)) & ~(pageSize - 1);
+    const auto end =
+        std::min((first + count) * sizeof(Amplitude), mappedBytes);
+    if (end > begin)
+      madvise(static_cast<char *>(mapping) + begin, end - begin,
+              MADV_WILLNEED);
+  }
+
+  void close() {
+    unmap();
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+};
+
+/// @brief A CPU state vector simulator for states that do not fit in memory.
+/// The amplitudes are kept in a `MappedStateFile` and updated with the same
+/// native kernels as `qpp-cpu`.
+///
+/// Every pass over the state reads and writes the whole file, so gates are
+/// scheduled to minimize the number of passes: runs of gates that act on the
+/// low ("local") qubits are applied one block of `2^localQubits` amplitudes
+/// at a time, with all gates of the run applied to a block while it is in
+/// memory (see `kernels::applyGatesBlocked`). Qubits above the block that are
+/// used repeatedly are swapped into it and stay there. Sampling,
+/// measurements and expectation values stream over the file, on the qubit
+/// positions given by `layout`.
+class MmapCircuitSimulator : public nvqir::CircuitSimulatorBase<double> {
+protected:
+  using Amplitude = std::complex<double>;
+
+  /// @brief Default number of local qubits: blocks of 256 MB.
+  static constexpr std::size_t defaultLocalQubits = 24;
+
+  MappedStateFile stateFile;
+
+  /// @brief Directory of the state file. It should be on a fast local drive.
+  std::string stateDirectory;
+
+  /// @brief Gates are applied block by block, on blocks of `2^localQubits`
+  /// amplitudes.
+  std::size_t localQubits = defaultLocalQubits;
+
+  /// @brief Physical positions of the qubits in the state file.
+  nvqir::QubitLayout layout;
+
+  std::size_t numQubitsInState() const {
+    return std::countr_zero(stateFile.size());
+  }
+
+  void addQubitToState() override { addQubitsToState(1); }
+
+  void addQubitsToState(std::size_t qubitCount,
+                        const void *stateDataIn = nullptr) override {
+    if (qubitCount == 0)
+      return;
+
+    const auto *factor = reinterpret_cast<const Amplitude *>(stateDataIn);
+    const std::size_t factorDim = 1ULL << qubitCount;
+    const std::size_t oldDim = stateFile.size();
+    if (oldDim == 0) {
+      layout.reset(qubitCount);
+      stateFile.resize(stateDirectory, factorDim);
+      if (factor)
+        std::copy(factor, factor + factorDim, stateFile.data());
+      else
+        stateFile.data()[0] = 1.0;
+      return;
+    }
+
+    // The new amplitudes of the file are already zero, which is all that
+    // growing the state with qubits in |0> requires.
+    layout.insert(numQubitsInState(), qubitCount);
+    stateFile.resize(stateDirectory, oldDim * factorDim);
+    if (factor)
+      nvqir::kernels::growState(stateFile.data(), oldDim, factor, factorDim);
+  }
+
+  void addQubitsToState(const cudaq::SimulationState &in_state) override {
+    const auto *const casted =
+        dynamic_cast<const nvqir::QppState<double> *>(&in_state);
+    if (!casted)
+      throw std::invalid_argument(
+          "[MmapCircuitSimulator] Incompatible state input");
+    addQubitsToState(casted->getNumQubits(), casted->state.data());
+  }
+
+  void deallocateStateImpl() override {
+    stateFile.close();
+    layout.reset(0);
+  }
+
+  void setToZeroState() override {
+    layout.reset(numQubitsInState());
+    stateFile.clear();
+    stateFile.data()[0] = 1.0;
+  }
+
+  void applyGate(const GateApplicationTask &task) override {
+    std::vector<std::size_t> controls, targets;
+    for (auto q : task.controls)
+      controls.push_back(layout.physical(q));
+    for (auto q : task.targets)
+      targets.push_back(layout.physical(q));
+    nvqir::kernels::applyGate(stateFile.data(), numQubitsInState(),
+                              task.matrix.data(), controls, targets);
+  }
+
+  void flushGateQueueImpl() override {
+    if (maxFusedQubits > 1 && gateQueue.size() > 1)
+      fuseGateQueue();
+    std::vector<GateApplicationTask> gates;
+    gates.reserve(gateQueue.size());
+    while (!gateQueue.empty()) {
+      gates.push_back(gateQueue.front());
+      gateQueue.pop();
+    }
+    if (gates.empty())
+      return;
+    nvqir::kernels::applyGatesBlocked(
+        stateFile.data(), numQubitsInState(), localQubits, layout, gates,
+        [this](std::size_t first, std::size_t count) {
+          stateFile.prefetch(first, count);
+        });
+  }
+
+  /// @brief Put the qubits of the state file back in the CUDA-Q order.
+  void restoreLayout() {
+    nvqir::kernels::restoreQubitOrder(stateFile.data(), numQubitsInState(),
+                                      layout);
+  }
+
+  /// @brief Measure the qubit, collapsing the state. If `resetToZero` is set,
+  /// the qubit is also flipped back to |0> in the same pass.
+  bool measure(const std::size_t qubit, bool resetToZero) {
+    const std::size_t numQubits = numQubitsInState();
+    const std::size_t index = layout.physical(qubit);
+    const double probOne = std::clamp(
+        nvqir::kernels::probabilityOfOne(stateFile.data(), numQubits, index),
+        0.0, 1.0);
+    std::discrete_distribution<int> outcomeDistribution{1.0 - probOne,
+                                                        probOne};
+    const bool result =
+        outcomeDistribution(qpp::RandomDevices::get_instance().get_prng()) ==
+        1;
+    const double outcomeProb = result ? probOne : 1.0 - probOne;
+    nvqir::kernels::collapse(stateFile.data(), numQubits, {index},
+                             result ? (1ULL << index) : 0,
+                             1.0 / std::sqrt(outcomeProb), resetToZero);
+    return result;
+  }
+
+  bool measureQubit(const std::size_t index) override {
+    const bool result = measure(index, /*resetToZero=*/false);
+    cudaq::info("Measured qubit {} -> {}", index, result);
+    return result;
+  }
+
+  /// @brief Expectation values of Pauli strings, in one streaming pass over
+  /// the state per distinct X mask.
+  std::vector<double>
+  pauliExpectations(std::vector<nvqir::kernels::PauliMasks> masks) {
+    for (auto &termMasks : masks) {
+      termMasks.x = layout.physicalIndex(termMasks.x);
+      termMasks.z = layout.physicalIndex(termMasks.z);
+    }
+    const auto *data = stateFile.data();
+    return nvqir::kernels::pauliExpectations(
+        [data](std::size_t i, std::size_t x) {
+          return nvqir::kernels::cmul(std::conj(data[i ^ x]), data[i]);
+        },
+        numQubitsInState(), masks);
+  }
+
+public:
+  MmapCircuitSimulator() {
+    summaryData.name = name();
+
+    stateDirectory = std::filesystem::temp_directory_path().string();
+    if (auto *dirEnvVar = std::getenv("CUDAQ_MMAP_STATE_DIR"))
+      stateDirectory = dirEnvVar;
+    cudaq::info("Storing the state vector in '{}'.", stateDirectory);
+
+    if (auto *localEnvVar = std::getenv("CUDAQ_MMAP_LOCAL_QUBITS")) {
+      const int local = std::atoi(localEnvVar);
+      if (local <= 0 || local >= 64)
+        throw std::runtime_error(
+            fmt::format("Invalid CUDAQ_MMAP_LOCAL_QUBITS environment variable "
+                        "setting. Expecting a positive integer value, got "
+                        "'{}'.",
+                        localEnvVar));
+      cudaq::info("Applying gates in blocks of {} qubits.", local);
+      localQubits = local;
+    }
+
+    // Fusing gates saves passes over the state file.
+    if (auto *fusionEnvVar = std::getenv("CUDAQ_FUSION_MAX_QUBITS")) {
+      const int fusionMaxQubits = std::atoi(fusionEnvVar);
+      if (fusionMaxQubits <= 0)
+        throw std::runtime_error(
+            fmt::format("Invalid CUDAQ_FUSION_MAX_QUBITS environment variable "
+                        "setting. Expecting a positive integer value, got "
+                        "'{}'.",
+                        fusionEnvVar));
+      cudaq::info("Enabling gate fusion up to {} qubits.", fusionMaxQubits);
+      maxFusedQubits = fusionMaxQubits;
+    }
+  }
+  virtual ~MmapCircuitSimulator() = default;
+
+  void setRandomSeed(std::size_t seed) override {
+    qpp::RandomDevices::get_instance().get_prng().seed(seed);
+  }
+
+  bool canHandleObserve() override {
+    // Do not compute <H> from matrix if shots based sampling requested
+    if (executionContext &&
+        executionContext->shots != static_cast<std::size_t>(-1))
+      return false;
+    return !shouldObserveFromSampling();
+  }
+
+  cudaq::observe_result observe(const cudaq::spin_op &op) override {
+    assert(cudaq::spin_op::canonicalize(op) == op);
+    flushGateQueue();
+
+    std::vector<nvqir::kernels::PauliMasks> masks;
+    std::vector<std::complex<double>> coefficients;
+    nvqir::toPauliMasks(op, numQubitsInState(), masks, coefficients);
+    const auto termValues = pauliExpectations(masks);
+    double ee = 0.0;
+    for (std::size_t t = 0; t < termValues.size(); ++t)
+      ee += (coefficients[t] * termValues[t]).real();
+
+    return cudaq::observe_result(
+        ee, op,
+        cudaq::sample_result(cudaq::ExecutionResult({}, op.to_string(), ee)));
+  }
+
+  void resetQubit(const std::size_t index) override {
+    flushGateQueue();
+    flushAnySamplingTasks();
+    measure(index, /*resetToZero=*/true);
+  }
+
+  cudaq::ExecutionResult sample(const std::vector<std::size_t> &qubits,
+                                const int shots) override {
+    flushGateQueue();
+    if (shots < 1) {
+      nvqir::kernels::PauliMasks zMask;
+      for (auto q : qubits)
+        zMask.z |= 1ULL << q;
+      const double expectationValue = pauliExpectations({zMask})[0];
+      cudaq::info("Computed expectation value = {}", expectationValue);
+      return cudaq::ExecutionResult{{}, expectationValue};
+    }
+
+    std::vector<std::size_t> positions;
+    for (auto q : qubits)
+      positions.push_back(layout.physical(q));
+    const auto *data = stateFile.data();
+    const auto sampleResult = nvqir::kernels::sampleOutcomes(
+        [data](std::size_t i) { return std::norm(data[i]); },
+        numQubitsInState(), positions, shots,
+        qpp::RandomDevices::get_instance().get_prng());
+    return nvqir::toExecutionResult(sampleResult, qubits.size(), shots);
+  }
+
+  /// @brief Export the state. This copies it to memory, so it must fit.
+  std::unique_ptr<cudaq::SimulationState> getSimulationState() override {
+    flushGateQueue();
+    restoreLayout();
+    return std::make_unique<nvqir::QppState<double>>(
+        qpp::ket(qpp::ket::Map(stateFile.data(), stateFile.size())));
+  }
+
+  bool isStateVectorSimulator() const override { return true; }
+
+  std::string name() const override { return "qpp-mmap"; }
+
+  NVQIR_SIMULATOR_CLONE_IMPL(MmapCircuitSimulator)
+};
+
+} // namespace
+
+/// Register this Simulator with NVQIR.
+NVQIR_REGISTER_SIMULATOR(MmapCircuitSimulator, qpp_mmap)
@@ -0,0 +1,567 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#define __NVQIR_QPP_TOGGLE_CREATE
+#include "QppCircuitSimulator.cpp"
+#undef __NVQIR_QPP_TOGGLE_CREATE
+
+#include "QubitLayout.h"
+#include "cudaq/distributed/mpi_plugin.h"
+
+namespace {
+
+/// @brief A CPU state vector simulator distributed over MPI ranks, through
+/// the CUDA-Q MPI plugin.
+///
+/// With `2^g` ranks, the amplitude index is split into `n - g` local bits and
+/// `g` global bits: rank `r` holds the amplitudes whose global bits equal
+/// `r`. Gates act on local qubits with the native kernels. A gate target on a
+/// global qubit is first swapped with the least recently used local qubit,
+/// which exchanges half of the local amplitudes with one partner rank; the
+/// qubit then stays local (`QubitLayout` tracks where each qubit lives), so
+/// repeated gates on it cost no further communication. Controls on global
+/// qubits need no communication: ranks where the control is |0> skip the
+/// gate.
+///
+/// Small states, or runs without MPI, are simulated on every rank
+/// redundantly; the state is split over the ranks once it has at least `g`
+/// more qubits than `CUDAQ_MPI_MIN_LOCAL_QUBITS`. Measurement outcomes and
+/// sampled shots are drawn by rank 0 (or split over the ranks by their share
+/// of the norm) so that all ranks agree on the results.
+class MpiCircuitSimulator : public nvqir::CircuitSimulatorBase<double> {
+protected:
+  using Amplitude = std::complex<double>;
+
+  /// @brief Default minimum number of local qubits per rank.
+  static constexpr std::size_t defaultMinLocalQubits = 12;
+
+  /// @brief Number of amplitudes per message when exchanging amplitudes with
+  /// a partner rank.
+  static constexpr std::size_t exchangeChunkSize = 1ULL << 20;
+
+  cudaqDistributedInterface_t *mpi = nullptr;
+  cudaqDistributedCommunicator_t *comm = nullptr;
+  int rank = 0;
+  int numRanks = 1;
+
+  /// @brief Number of global qubits once the state is distributed.
+  std::size_t rankQubits = 0;
+
+  std::size_t minLocalQubits = defaultMinLocalQubits;
+
+  /// @brief The amplitudes held by this rank, in physical order.
+  std::vector<Amplitude> localState;
+  std::size_t numQubits = 0;
+
+  /// @brief Number of local qubits, i.e., `numQubits` unless distributed.
+  std::size_t numLocalQubits = 0;
+
+  nvqir::QubitLayout layout;
+
+  bool isDistributed() const { return numLocalQubits < numQubits; }
+
+  /// @brief The global bits of this rank's amplitude indices.
+  std::size_t rankBits() const {
+    return isDistributed() ? static_cast<std::size_t>(rank) << numLocalQubits
+                           : 0;
+  }
+
+  static void check(int status, const char *call) {
+    if (status != 0)
+      throw std::runtime_error(
+          fmt::format("[qpp-mpi] {} failed with error {}.", call, status));
+  }
+
+  /// @brief Pick up the MPI communicator, if MPI has been initialized.
+  void initCommunicator() {
+    if (mpi)
+      return;
+    auto *plugin = cudaq::mpi::getMpiPlugin(/*unsafe=*/true);
+    if (!plugin || !plugin->is_initialized())
+      return;
+    mpi = plugin->get();
+    comm = plugin->getComm();
+    if (!mpi || !comm)
+      throw std::runtime_error(
+          "[qpp-mpi] Invalid MPI distributed plugin encountered");
+    rank = plugin->rank();
+    numRanks = plugin->num_ranks();
+    if (!std::has_single_bit(static_cast<unsigned>(numRanks)))
+      throw std::runtime_error(fmt::format(
+          "[qpp-mpi] The number of MPI ranks must be a power of two, got {}.",
+          numRanks));
+    rankQubits = std::countr_zero(static_cast<unsigned>(numRanks));
+    cudaq::info("[qpp-mpi] Distributing the state over {} ranks.", numRanks);
+  }
+
+  /// @brief Sum `values` over the ranks, if the state is distributed.
+  void allreduceSum(std::vector<double> &values) {
+    if (isDistributed())
+      check(mpi->AllreduceInPlace(comm, values.data(), values.size(),
+                                  FLOAT_64, SUM),
+            "Allreduce");
+  }
+
+  /// @brief Merge the sampled outcomes of all ranks.
+  std::vector<std::pair<std::uint64_t, std::size_t>> allgatherOutcomes(
+      const std::vector<std::pair<std::uint64_t, std::size_t>> &outcomes) {
+    std::vector<std::int64_t> flat;
+    for (auto [key, count] : outcomes) {
+      flat.push_back(key);
+      flat.push_back(count);
+    }
+    const std::int32_t localSize = flat.size();
+    std::vector<std::int32_t> sizes(numRanks), offsets(numRanks, 0);
+    check(mpi->Allgather(comm, &localSize, sizes.data(), 1, INT_32),
+          "Allgather");
+    for (int r = 1; r < numRanks; ++r)
+      offsets[r] = offsets[r - 1] + sizes[r - 1];
+    std::vector<std::int64_t> all(offsets.back() + sizes.back());
+    check(mpi->AllgatherV(comm, flat.data(), localSize, all.data(),
+                          sizes.data(), offsets.data(), INT_64),
+          "AllgatherV");
+    std::map<std::uint64_t, std::size_t> merged;
+    for (std::size_t i = 0; i < all.size(); i += 2)
+      merged[all[i]] += all[i + 1];
+    return {merged.begin(), merged.end()};
+  }
+
+  /// @brief Swap the qubits at the global position `globalPos` and the local
+  /// position `localPos`. Each rank keeps the half of its amplitudes whose
+  /// local bit equals its global bit and trades the other half with the
+  /// partner rank that differs in that global bit.
+  void swapGlobalQubit(std::size_t globalPos, std::size_t localPos) {
+    const std::size_t rankBit = globalPos - numLocalQubits;
+    const int partner = rank ^ (1 << rankBit);
+    const std::size_t traded = 1 - ((rank >> rankBit) & 1);
+    const std::size_t lowMask = (1ULL << localPos) - 1;
+    const auto slot = [&](std::size_t k) {
+      return nvqir::kernels::insertZeroBits(k, &lowMask, 1) |
+             (traded << localPos);
+    };
+
+    // Double buffered, so that packing and unpacking overlap with the
+    // exchange of the neighboring chunks.
+    const std::size_t half = localState.size() / 2;
+    const std::size_t chunkSize = std::min(half, exchangeChunkSize);
+    const std::size_t numChunks = (half + chunkSize - 1) / chunkSize;
+    std::vector<Amplitude> sendBuffers[2], recvBuffers[2];
+    for (int b = 0; b < 2; ++b) {
+      sendBuffers[b].resize(chunkSize);
+      recvBuffers[b].resize(chunkSize);
+    }
+    const auto chunkCount = [&](std::size_t c) {
+      return std::min(chunkSize, half - c * chunkSize);
+    };
+    const auto pack = [&](std::size_t c) {
+      auto *buffer = sendBuffers[c % 2].data();
+      const std::size_t first = c * chunkSize, count = chunkCount(c);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (count >= nvqir::kernels::minParallelWork)
+#endif
+      for (std::size_t k = 0; k < count; ++k)
+        buffer[k] = localState[slot(first + k)];
+    };
+    const auto post = [&](std::size_t c) {
+      check(mpi->SendRecvAsync(comm, sendBuffers[c % 2].data(),
+                               recvBuffers[c % 2].data(), chunkCount(c),
+                               DOUBLE_COMPLEX, partner, /*tag=*/0),
+            "SendRecvAsync");
+    };
+
+    pack(0);
+    post(0);
+    for (std::size_t c = 0; c < numChunks; ++c) {
+      if (c + 1 < numChunks)
+        pack(c + 1);
+      check(mpi->Synchronize(comm), "Synchronize");
+      if (c + 1 < numChunks)
+        post(c + 1);
+      const auto *buffer = recvBuffers[c % 2].data();
+      const std::size_t first = c * chunkSize, count = chunkCount(c);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (count >= nvqir::kernels::minParallelWork)
+#endif
+      for (std::size_t k = 0; k < count; ++k)
+        localState[slot(first + k)] = buffer[k];
+    }
+    layout.swapPositions(globalPos, localPos);
+  }
+
+  /// @brief Move `qubit` into the local part if needed, keeping the
+  /// positions in `pinned` local. Returns its local position.
+  std::size_t makeLocal(std::size_t qubit, std::uint64_t pinned) {
+    const std::size_t position = layout.physical(qubit);
+    if (position < numLocalQubits)
+      return position;
+    const std::size_t victim =
+        layout.leastRecentlyUsed(0, numLocalQubits, pinned);
+    if (victim == numLocalQubits)
+      throw std::runtime_error(
+          fmt::format("[qpp-mpi] An operation needs more than the {} local "
+                      "qubits of each rank.",
+                      numLocalQubits));
+    swapGlobalQubit(position, victim);
+    return victim;
+  }
+
+  void addQubitToState() override { addQubitsToState(1); }
+
+  void addQubitsToState(std::size_t qubitCount,
+                        const void *stateDataIn = nullptr) override {
+    if (qubitCount == 0)
+      return;
+    initCommunicator();
+    const auto *factor = reinterpret_cast<const Amplitude *>(stateDataIn);
+    if (numQubits == 0) {
+      localState.assign(1, 1.0);
+      layout.reset(0);
+    }
+
+    // The new qubits take the physical positions right above the current
+    // local ones.
+    const std::size_t newNumQubits = numQubits + qubitCount;
+    if (!isDistributed() && rankQubits > 0 &&
+        newNumQubits >= rankQubits + minLocalQubits) {
+      // Build this rank's part of `kron(factor, psi)` directly, without
+      // forming the whole state.
+      const std::size_t newLocalQubits = newNumQubits - rankQubits;
+      const std::size_t localDim = 1ULL << newLocalQubits;
+      const std::size_t offset = static_cast<std::size_t>(rank) * localDim;
+      const std::size_t oldDim = localState.size();
+      std::vector<Amplitude> slice(localDim);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (localDim >= nvqir::kernels::minParallelWork)
+#endif
+      for (std::size_t j = 0; j < localDim; ++j) {
+        const std::size_t i = offset + j;
+        const std::size_t high = i / oldDim;
+        const Amplitude scale =
+            factor ? factor[high] : Amplitude(high == 0 ? 1.0 : 0.0);
+        slice[j] = scale * localState[i % oldDim];
+      }
+      localState = std::move(slice);
+      layout.insert(numLocalQubits, qubitCount);
+      numLocalQubits = newLocalQubits;
+    } else {
+      const std::size_t oldDim = localState.size();
+      localState.resize(oldDim << qubitCount);
+      if (factor)
+        nvqir::kernels::growState(localState.data(), oldDim, factor,
+                                  1ULL << qubitCount);
+      layout.insert(numLocalQubits, qubitCount);
+      numLocalQubits += qubitCount;
+    }
+    numQubits = newNumQubits;
+  }
+
+  void addQubitsToState(const cudaq::SimulationState &in_state) override {
+    const auto *const casted =
+        dynamic_cast<const nvqir::QppState<double> *>(&in_state);
+    if (!casted)
+      throw std::invalid_argument(
+          "[MpiCircuitSimulator] Incompatible state input");
+    addQubitsToState(casted->getNumQubits(), casted->state.data());
+  }
+
+  void deallocateStateImpl() override {
+    localState.clear();
+    localState.shrink_to_fit();
+    numQubits = 0;
+    numLocalQubits = 0;
+    layout.reset(0);
+  }
+
+  void setToZeroState() override {
+    nvqir::kernels::clearState(localState.data(), localState.size());
+    if (rankBits() == 0)
+      localState[0] = 1.0;
+    layout.reset(numQubits);
+  }
+
+  void applyGate(const GateApplicationTask &task) override {
+    std::uint64_t pinned = 0;
+    for (auto t : task.targets)
+      if (layout.physical(t) < numLocalQubits)
+        pinned |= 1ULL << layout.physical(t);
+    for (auto t : task.targets)
+      pinned |= 1ULL << makeLocal(t, pinned);
+
+    // A global control set to 0 on this rank makes the gate a no-op here.
+    std::vector<std::size_t> controls, targets;
+    bool active = true;
+    for (auto c : task.controls) {
+      const std::size_t position = layout.physical(c);
+      if (position < numLocalQubits)
+        controls.push_back(position);
+      else if (!((rankBits() >> position) & 1))
+        active = false;
+    }
+    for (auto t : task.targets)
+      targets.push_back(layout.physical(t));
+    // The layout must evolve the same way on all ranks, so it is updated
+    // whether or not the gate applies on this one.
+    for (auto p : controls)
+      layout.touch(p);
+    for (auto p : targets)
+      layout.touch(p);
+    if (active)
+      nvqir::kernels::applyGate(localState.data(), numLocalQubits,
+                                task.matrix.data(), controls, targets);
+  }
+
+  /// @brief Measure the qubit, collapsing the state. If `resetToZero` is set,
+  /// the qubit is also flipped back to |0>.
+  bool measure(const std::size_t qubit, bool resetToZero) {
+    // Resetting moves amplitudes across the qubit, so it must be local.
+    const std::size_t position =
+        resetToZero ? makeLocal(qubit, 0) : layout.physical(qubit);
+    const bool isLocal = position < numLocalQubits;
+    const bool rankValue = (rankBits() >> position) & 1;
+    std::vector<double> probOne{
+        isLocal ? nvqir::kernels::probabilityOfOne(localState.data(),
+                                                   numLocalQubits, position)
+        : rankValue
+            ? nvqir::kernels::squaredNorm(localState.data(), localState.size())
+            : 0.0};
+    allreduceSum(probOne);
+    const double p1 = std::clamp(probOne[0], 0.0, 1.0);
+
+    std::int32_t result = 0;
+    if (rank == 0) {
+      std::discrete_distribution<int> outcomeDistribution{1.0 - p1, p1};
+      result =
+          outcomeDistribution(qpp::RandomDevices::get_instance().get_prng());
+    }
+    if (numRanks > 1)
+      check(mpi->Bcast(comm, &result, 1, INT_32, 0), "Bcast");
+
+    const double scale = 1.0 / std::sqrt(result ? p1 : 1.0 - p1);
+    if (isLocal)
+      nvqir::kernels::collapse(localState.data(), numLocalQubits, {position},
+                               static_cast<std::size_t>(result) << position,
+                               scale, resetToZero);
+    else if (rankValue == static_cast<bool>(result))
+      nvqir::kernels::scaleState(localState.data(), localState.size(), scale);
+    else
+      nvqir::kernels::clearState(localState.data(), localState.size());
+    return result;
+  }
+
+  bool measureQubit(const std::size_t index) override {
+    const bool result = measure(index, /*resetToZero=*/false);
+    cudaq::info("Measured qubit {} -> {}", index, result);
+    return result;
+  }
+
+  /// @brief Expectation values of Pauli strings given in logical qubits,
+  /// summed over the ranks. The X qubits of each string are moved into the
+  /// local part first, so that all the amplitude pairs are on the same rank.
+  std::vector<double>
+  pauliExpectations(const std::vector<nvqir::kernels::PauliMasks> &masks) {
+    std::map<std::size_t, std::vector<std::size_t>> groups;
+    for (std::size_t t = 0; t < masks.size(); ++t)
+      groups[masks[t].x].push_back(t);
+
+    std::vector<double> values(masks.size(), 0.0);
+    for (const auto &[x, terms] : groups) {
+      std::uint64_t pinned = 0;
+      for (auto bits = x; bits; bits &= bits - 1)
+        if (layout.physical(std::countr_zero(bits)) < numLocalQubits)
+          pinned |= 1ULL << layout.physical(std::countr_zero(bits));
+      for (auto bits = x; bits; bits &= bits - 1)
+        pinned |= 1ULL << makeLocal(std::countr_zero(bits), pinned);
+
+      // Z factors on global qubits only contribute a sign per rank.
+      std::vector<nvqir::kernels::PauliMasks> localMasks;
+      std::vector<bool> flipped;
+      for (auto t : terms) {
+        nvqir::kernels::PauliMasks local;
+        local.numY = masks[t].numY;
+        bool flip = false;
+        for (auto bits = masks[t].x; bits; bits &= bits - 1)
+          local.x |= 1ULL << layout.physical(std::countr_zero(bits));
+        for (auto bits = masks[t].z; bits; bits &= bits - 1) {
+          const std::size_t position = layout.physical(std::countr_zero(bits));
+          if (position < numLocalQubits)
+            local.z |= 1ULL << position;
+          else
+            flip ^= (rankBits() >> position) & 1;
+        }
+        localMasks.push_back(local);
+        flipped.push_back(flip);
+      }
+
+      const auto *data = localState.data();
+      const auto groupValues = nvqir::kernels::pauliExpectations(
+          [data](std::size_t i, std::size_t x) {
+            return nvqir::kernels::cmul(std::conj(data[i ^ x]), data[i]);
+          },
+          numLocalQubits, localMasks);
+      for (std::size_t k = 0; k < terms.size(); ++k)
+        values[terms[k]] = flipped[k] ? -groupValues[k] : groupValues[k];
+    }
+    allreduceSum(values);
+    return values;
+  }
+
+public:
+  MpiCircuitSimulator() {
+    summaryData.name = name();
+    if (auto *localEnvVar = std::getenv("CUDAQ_MPI_MIN_LOCAL_QUBITS")) {
+      const int local = std::atoi(localEnvVar);
+      if (local <= 0 || local >= 64)
+        throw std::runtime_error(
+            fmt::format("Invalid CUDAQ_MPI_MIN_LOCAL_QUBITS environment "
+                        "variable setting. Expecting a positive integer "
+                        "value, got '{}'.",
+                        localEnvVar));
+      cudaq::info("Keeping at least {} local qubits per rank.", local);
+      minLocalQubits = local;
+    }
+  }
+  virtual ~MpiCircuitSimulator() = default;
+
+  void setRandomSeed(std::size_t seed) override {
+    // Ranks sample their own shares of the shots, from different streams.
+    initCommunicator();
+    qpp::RandomDevices::get_instance().get_prng().seed(seed + rank);
+  }
+
+  bool canHandleObserve() override {
+    // Do not compute <H> from matrix if shots based sampling requested
+    if (executionContext &&
+        executionContext->shots != static_cast<std::size_t>(-1))
+      return false;
+    return !shouldObserveFromSampling();
+  }
+
+  cudaq::observe_result observe(const cudaq::spin_op &op) override {
+    assert(cudaq::spin_op::canonicalize(op) == op);
+    flushGateQueue();
+
+    std::vector<nvqir::kernels::PauliMasks> masks;
+    std::vector<std::complex<double>> coefficients;
+    nvqir::toPauliMasks(op, numQubits, masks, coefficients);
+    const auto termValues = pauliExpectations(masks);
+    double ee = 0.0;
+    for (std::size_t t = 0; t < termValues.size(); ++t)
+      ee += (coefficients[t] * termValues[t]).real();
+
+    return cudaq::observe_result(
+        ee, op,
+        cudaq::sample_result(cudaq::ExecutionResult({}, op.to_string(), ee)));
+  }
+
+  void resetQubit(const std::size_t index) override {
+    flushGateQueue();
+    flushAnySamplingTasks();
+    measure(index, /*resetToZero=*/true);
+  }
+
+  cudaq::ExecutionResult sample(const std::vector<std::size_t> &qubits,
+                                const int shots) override {
+    flushGateQueue();
+    if (shots < 1) {
+      nvqir::kernels::PauliMasks zMask;
+      for (auto q : qubits)
+        zMask.z |= 1ULL << q;
+      const double expectationValue = pauliExpectations({zMask})[0];
+      cudaq::info("Computed expectation value = {}", expectationValue);
+      return cudaq::ExecutionResult{{}, expectationValue};
+    }
+
+    // Global measured qubits are constant on each rank.
+    std::vector<std::size_t> positions;
+    std::uint64_t rankKey = 0;
+    for (std::size_t b = 0; b < qubits.size(); ++b) {
+      positions.push_back(layout.physical(qubits[b]));
+      if (positions.back() >= numLocalQubits &&
+          ((rankBits() >> positions.back()) & 1))
+        rankKey |= 1ULL << b;
+    }
+
+    // Split the shots over the ranks by the norm of their amplitudes. A
+    // state held by every rank is sampled by rank 0 only.
+    auto &gen = qpp::RandomDevices::get_instance().get_prng();
+    std::size_t localShots = rank == 0 ? shots : 0;
+    if (isDistributed()) {
+      const double localNorm =
+          nvqir::kernels::squaredNorm(localState.data(), localState.size());
+      std::vector<double> norms(numRanks);
+      check(mpi->Allgather(comm, &localNorm, norms.data(), 1, FLOAT_64),
+            "Allgather");
+      std::vector<std::int64_t> rankShots(numRanks, 0);
+      if (rank == 0)
+        for (auto [r, count] :
+             nvqir::kernels::sampleMarginal(norms, shots, gen))
+          rankShots[r] = count;
+      check(mpi->Bcast(comm, rankShots.data(), numRanks, INT_64, 0), "Bcast");
+      localShots = rankShots[rank];
+    }
+
+    std::vector<std::pair<std::uint64_t, std::size_t>> sampleResult;
+    if (localShots > 0) {
+      const auto *data = localState.data();
+      sampleResult = nvqir::kernels::sampleOutcomes(
+          [data](std::size_t i) { return std::norm(data[i]); },
+          numLocalQubits, positions, localShots, gen);
+      for (auto &outcome : sampleResult)
+        outcome.first |= rankKey;
+    }
+    if (numRanks > 1)
+      sampleResult = allgatherOutcomes(sampleResult);
+    return nvqir::toExecutionResult(sampleResult, qubits.size(), shots);
+  }
+
+  /// @brief Export the state. Every rank gets a copy of the whole state, so
+  /// it must fit in the memory of one rank.
+  std::unique_ptr<cudaq::SimulationState> getSimulationState() override {
+    flushGateQueue();
+    const std::size_t dim = 1ULL << numQubits;
+    std::vector<Amplitude> gathered;
+    const Amplitude *physicalState = localState.data();
+    if (isDistributed()) {
+      if (dim > static_cast<std::size_t>(std::numeric_limits<int32_t>::max()))
+        throw std::runtime_error(
+            "[qpp-mpi] The state is too large to be gathered on one rank.");
+      const std::int32_t localDim = localState.size();
+      std::vector<std::int32_t> sizes(numRanks, localDim), offsets(numRanks);
+      for (int r = 0; r < numRanks; ++r)
+        offsets[r] = r * localDim;
+      gathered.resize(dim);
+      check(mpi->AllgatherV(comm, localState.data(), localDim, gathered.data(),
+                            sizes.data(), offsets.data(), DOUBLE_COMPLEX),
+            "AllgatherV");
+      physicalState = gathered.data();
+    }
+
+    qpp::ket state(dim);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (dim >= nvqir::kernels::minParallelWork)
+#endif
+    for (std::size_t i = 0; i < dim; ++i)
+      state(i) = physicalState[layout.physicalIndex(i)];
+    return std::make_unique<nvqir::QppState<double>>(std::move(state));
+  }
+
+  bool isStateVectorSimulator() const override { return true; }
+
+  std::string name() const override { return "qpp-mpi"; }
+
+  NVQIR_SIMULATOR_CLONE_IMPL(MpiCircuitSimulator)
+};
+
+} // namespace
+
+/// Register this Simulator with NVQIR.
+NVQIR_REGISTER_SIMULATOR(MpiCircuitSimulator, qpp_mpi)
@@ -6,34 +6,47 @@
  * the terms of the Apache License 2.0 which accompanies this distribution.    *
  ******************************************************************************/
 
+#include "CacheBlocking.h"
+#include "SamplingKernels.h"
+#include "StatePool.h"
+#include "StateVectorKernels.h"
 #include "nvqir/CircuitSimulator.h"
 #include "nvqir/Gates.h"
 
 #include <bit>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <qpp.h>
+#include <random>
 #include <set>
-#include <span>
 
 using namespace cudaq;
 
 namespace nvqir {
 
+/// @brief Single-precision counterpart of `qpp::ket`.
+using QppKetFp32 = Eigen::Matrix<std::complex<float>, Eigen::Dynamic, 1>;
+
 /// @brief QppState provides an implementation of `SimulationState` that
 /// encapsulates the state data for the Qpp Circuit Simulator.
+template <typename ScalarType>
 struct QppState : public cudaq::SimulationState {
+  using KetType = Eigen::Matrix<std::complex<ScalarType>, Eigen::Dynamic, 1>;
+
   /// @brief The state. This class takes ownership move semantics.
-  qpp::ket state;
+  KetType state;
 
-  QppState(qpp::ket &&data) : state(std::move(data)) {}
+  QppState(KetType &&data) : state(std::move(data)) {}
   QppState(const std::vector<std::size_t> &shape,
            const std::vector<std::complex<double>> &data) {
     if (shape.size() != 1)
       throw std::runtime_error(
           "QppState must be created from data with 1D shape.");
 
-    state = Eigen::Map<qpp::ket>(
-        const_cast<std::complex<double> *>(data.data()), shape[0]);
+    state = Eigen::Map<const qpp::ket>(data.data(), shape[0])
+                .template cast<std::complex<ScalarType>>();
   }
 
   std::size_t getNumQubits() const override { return std::log2(state.size()); }
@@ -44,13 +57,14 @@ struct QppState : public cudaq::SimulationState {
       throw std::runtime_error("[qpp-state] overlap error - other state "
                                "dimension not equal to this state dimension.");
 
-    std::span<std::complex<double>> otherState(
-        reinterpret_cast<std::complex<double> *>(other.getTensor().data),
-        other.getTensor().extents[0]);
-    return std::abs(std::inner_product(
-        state.begin(), state.end(), otherState.begin(), complex{0., 0.},
-        [](auto a, auto b) { return a + b; },
-        [](auto a, auto b) { return a * std::conj(b); }));
+    if (other.getPrecision() != getPrecision())
+      throw std::runtime_error("[qpp-state] overlap error - other state "
+                               "precision not equal to this state precision.");
+
+    const auto *otherState =
+        reinterpret_cast<std::complex<ScalarType> *>(other.getTensor().data);
+    return std::abs(nvqir::kernels::innerProduct(
+        state.data(), otherState, static_cast<std::size_t>(state.size())));
   }
 
   std::complex<double>
@@ -71,7 +85,31 @@ struct QppState : public cudaq::SimulationState {
         std::make_reverse_iterator(basisState.end()),
         std::make_reverse_iterator(basisState.begin()), 0ull,
         [](std::size_t acc, int bit) { return (acc << 1) + bit; });
-    return state[idx];
+    return static_cast<std::complex<double>>(state[idx]);
+  }
+
+  std::vector<std::complex<double>>
+  getAmplitudes(const std::vector<std::vector<int>> &basisStates) override {
+    // Invalid basis states get the errors of `getAmplitude`.
+    for (const auto &basisState : basisStates)
+      if (getNumQubits() != basisState.size() ||
+          std::any_of(basisState.begin(), basisState.end(),
+                      [](int x) { return x != 0 && x != 1; }))
+        return SimulationState::getAmplitudes(basisStates);
+
+    std::vector<std::complex<double>> amplitudes(basisStates.size());
+    const std::size_t count = basisStates.size();
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (count >= nvqir::kernels::minParallelWork)
+#endif
+    for (std::size_t k = 0; k < count; ++k) {
+      std::size_t idx = 0;
+      for (std::size_t q = 0; q < basisStates[k].size(); ++q)
+        idx |= static_cast<std::size_t>(basisStates[k][q]) << q;
+      amplitudes[k] = static_cast<std::complex<double>>(state[idx]);
+    }
+    return amplitudes;
   }
 
   Tensor getTensor(std::size_t tensorIdx = 0) const override {
@@ -79,7 +117,7 @@ struct QppState : public cudaq::SimulationState {
       throw std::runtime_error("[qpp-state] invalid tensor requested.");
     return Tensor{
         reinterpret_cast<void *>(
-            const_cast<std::complex<double> *>(state.data())),
+            const_cast<std::complex<ScalarType> *>(state.data())),
         std::vector<std::size_t>{static_cast<std::size_t>(state.size())},
         getPrecision()};
   }
@@ -98,36 +136,447 @@ struct QppState : public cudaq::SimulationState {
     if (indices.size() != 1)
       throw std::runtime_error("[qpp-state] invalid element extraction.");
 
-    return state[indices[0]];
+    return static_cast<std::complex<double>>(state[indices[0]]);
   }
 
   std::unique_ptr<SimulationState>
   createFromSizeAndPtr(std::size_t size, void *ptr, std::size_t) override {
-    return std::make_unique<QppState>(Eigen::Map<qpp::ket>(
-        reinterpret_cast<std::complex<double> *>(ptr), size));
+    return std::make_unique<QppState>(Eigen::Map<KetType>(
+        reinterpret_cast<std::complex<ScalarType> *>(ptr), size));
   }
 
   void dump(std::ostream &os) const override { os << state << "\n"; }
 
   precision getPrecision() const override {
+    if constexpr (std::is_same_v<ScalarType, float>)
+      return cudaq::SimulationState::precision::fp32;
+
     return cudaq::SimulationState::precision::fp64;
   }
 
   void destroyState() override {
-    qpp::ket k;
+    KetType k;
     state = k;
   }
 };
 
+/// @brief Get the X/Z bitmasks and the coefficients of the terms of `op`,
+/// for a state of `numQubits` qubits. Each term is a Pauli string scaled by
+/// its coefficient; the simulators evaluate the strings directly from their
+/// bitmasks rather than building the dense matrix of the whole operator.
+inline void toPauliMasks(const cudaq::spin_op &op, std::size_t numQubits,
+                         std::vector<kernels::PauliMasks> &masks,
+                         std::vector<std::complex<double>> &coefficients) {
+  masks.reserve(op.num_terms());
+  coefficients.reserve(op.num_terms());
+  for (const auto &term : op) {
+    kernels::PauliMasks termMasks;
+    for (const auto &p : term) {
+      const auto pauli = p.as_pauli();
+      if (pauli == cudaq::pauli::I)
+        continue;
+      const std::size_t target = p.target();
+      if (target >= numQubits)
+        throw std::runtime_error(fmt::format(
+            "observe: operator acts on qubit {} but the state only has {} "
+            "qubits",
+            target, numQubits));
+      if (pauli != cudaq::pauli::Z)
+        termMasks.x |= 1ULL << target;
+      if (pauli != cudaq::pauli::X)
+        termMasks.z |= 1ULL << target;
+      if (pauli == cudaq::pauli::Y)
+        ++termMasks.numY;
+    }
+    masks.push_back(termMasks);
+    coefficients.push_back(term.evaluate_coefficient());
+  }
+}
+
+/// @brief Convert the outcomes drawn by `kernels::sampleOutcomes` for
+/// `numQubits` measured qubits into sampling results.
+inline cudaq::ExecutionResult toExecutionResult(
+    const std::vector<std::pair<std::uint64_t, std::size_t>> &sampleResult,
+    std::size_t numQubits, int shots) {
+  // Outcomes are packed keys with bit `b` holding the result for
+  // `qubits[b]`; convert each distinct outcome to a bitstring only once.
+  cudaq::ExecutionResult counts;
+  double expVal = 0.0;
+  std::string bitstring(numQubits, '0');
+  for (auto [key, count] : sampleResult) {
+    for (std::size_t b = 0; b < numQubits; ++b)
+      bitstring[b] = ((key >> b) & 1) ? '1' : '0';
+
+    // Add to the sample result
+    // in mid-circ sampling mode this will append 1 bitstring
+    counts.appendResult(bitstring, count);
+    auto p = count / (double)shots;
+    if (std::popcount(key) % 2)
+      p = -p;
+    expVal += p;
+  }
+
+  counts.expectationValue = expVal;
+  return counts;
+}
+
 /// @brief The QppCircuitSimulator implements the CircuitSimulator
 /// base class to provide a simulator delegating to the Q++ library from
 /// https://github.com/softwareqinc/qpp.
+///
+/// The scalar type of `StateType` sets the simulation precision: `qpp::ket`
+/// and `qpp::cmat` simulate in FP64, `QppKetFp32` in FP32.
 template <typename StateType>
-class QppCircuitSimulator : public nvqir::CircuitSimulatorBase<double> {
+class QppCircuitSimulator
+    : public nvqir::CircuitSimulatorBase<typename StateType::RealScalar> {
 protected:
-  /// The QPP state representation (qpp::ket or qpp::cmat)
+  using ScalarType = typename StateType::RealScalar;
+  using KetType = Eigen::Matrix<std::complex<ScalarType>, Eigen::Dynamic, 1>;
+  using GateApplicationTask = typename nvqir::CircuitSimulatorBase<
+      ScalarType>::GateApplicationTask;
+  using nvqir::CircuitSimulatorBase<ScalarType>::stateDimension;
+  using nvqir::CircuitSimulatorBase<ScalarType>::executionContext;
+  using nvqir::CircuitSimulatorBase<ScalarType>::flushGateQueue;
+  using nvqir::CircuitSimulatorBase<ScalarType>::flushAnySamplingTasks;
+  using nvqir::CircuitSimulatorBase<ScalarType>::shouldObserveFromSampling;
+  using nvqir::CircuitSimulatorBase<ScalarType>::summaryData;
+  using nvqir::CircuitSimulatorBase<ScalarType>::maxFusedQubits;
+  using nvqir::CircuitSimulatorBase<ScalarType>::gateQueue;
+  using nvqir::CircuitSimulatorBase<ScalarType>::fuseGateQueue;
+  using nvqir::CircuitSimulatorBase<ScalarType>::branchingMeasurements;
+  using nvqir::CircuitSimulatorBase<ScalarType>::skippingBranchPrefix;
+  using nvqir::CircuitSimulatorBase<ScalarType>::measureBranch;
+  using nvqir::CircuitSimulatorBase<ScalarType>::setBasisState;
+
+  /// @brief True for state vector simulation, false for density matrices.
+  static constexpr bool isKet = StateType::ColsAtCompileTime == 1;
+
+  /// The QPP state representation (qpp::ket, QppKetFp32 or qpp::cmat)
   StateType state;
 
+  /// @brief Released state buffers, reused by later allocations of the same
+  /// size. The simulator instance is thread-local, so this outlives a single
+  /// kernel execution.
+  StatePool<StateType> statePool;
+
+  /// @brief Default number of block qubits for cache-blocked gate
+  /// application: blocks of 256 KB in FP64, which fit in the L2 cache.
+  static constexpr std::size_t defaultBlockQubits = 14;
+
+  /// @brief Runs of gates are applied block by block on blocks of
+  /// `2^blockQubits` amplitudes (see `kernels::applyGatesBlocked`), or one
+  /// by one if zero.
+  std::size_t blockQubits = defaultBlockQubits;
+
+  /// @brief Physical positions of the qubits in `state` after cache-blocked
+  /// gate application. Empty if the state is in the CUDA-Q qubit order.
+  ///
+  /// Sampling, measurements and resets translate their qubits through the
+  /// layout; other operations reading the state restore the CUDA-Q order
+  /// first, see `restoreLayout`.
+  QubitLayout layout;
+
+  /// @brief Put the qubits of the state back in the CUDA-Q order.
+  void restoreLayout() {
+    if constexpr (isKet) {
+      if (layout.size() == 0)
+        return;
+      nvqir::kernels::restoreQubitOrder(state.data(), numQubitsInState(),
+                                        layout);
+      layout.reset(0);
+    }
+  }
+
+  /// @brief The physical position of qubit `index` in the state.
+  std::size_t physicalQubit(std::size_t index) const {
+    return layout.size() == 0 ? index : layout.physical(index);
+  }
+
+  /// @brief Replace the state with a pooled |0...0> state of dimension
+  /// `stateDimension`.
+  void allocateZeroState() {
+    layout.reset(0);
+    statePool.release(std::move(state));
+    state = statePool.acquire(stateDimension, isKet ? 1 : stateDimension);
+    state(0) = 1.0;
+  }
+
+  /// @brief Random number generator driving measurements and noise.
+  using TrajectoryGenerator = std::remove_reference_t<
+      decltype(qpp::RandomDevices::get_instance().get_prng())>;
+
+  /// @brief One recorded step of the circuit, which can be applied to any
+  /// state vector with its own random number generator.
+  using TrajectoryOp = std::function<void(KetType &, TrajectoryGenerator &)>;
+
+  /// @brief Number of trajectories for noisy observe and sampling when the
+  /// execution context does not set one. Same as the tensor network backends.
+  static constexpr std::size_t defaultNumTrajectories = 1000;
+
+  /// @brief States below this dimension are too small for the gate kernels to
+  /// run in parallel, so trajectories run concurrently instead.
+  static constexpr std::size_t maxConcurrentTrajectoryDim = 1ULL << 14;
+
+  /// @brief Noisy state vector simulation follows a single trajectory: each
+  /// channel applies one Kraus operator, drawn with its probability. While a
+  /// noise model is set, every operation since the state was allocated is
+  /// recorded so that sampling and observe can average over more
+  /// trajectories by replaying it.
+  std::vector<TrajectoryOp> trajectoryLog;
+
+  /// @brief True if operations are being recorded into `trajectoryLog`.
+  bool recordingTrajectory = false;
+
+  /// @brief True if `trajectoryLog` contains noise channels, i.e., replaying
+  /// it can give a different state.
+  bool trajectoryHasNoise = false;
+
+  /// @brief Start a new trajectory log for a state allocated from scratch.
+  void startTrajectoryLog() {
+    trajectoryLog.clear();
+    trajectoryHasNoise = false;
+    recordingTrajectory =
+        isKet && executionContext && executionContext->noiseModel;
+  }
+
+  void recordTrajectoryOp(TrajectoryOp op) {
+    if (recordingTrajectory)
+      trajectoryLog.push_back(std::move(op));
+  }
+
+  /// @brief Apply the row-major gate `matrix` to the state vector `psi`.
+  static void applyKetGate(KetType &psi,
+                           const std::complex<ScalarType> *matrix,
+                           const std::vector<std::size_t> &controls,
+                           const std::vector<std::size_t> &targets) {
+    const std::size_t numQubits =
+        std::countr_zero(static_cast<std::size_t>(psi.size()));
+    nvqir::kernels::applyGate(psi.data(), numQubits, matrix, controls,
+                              targets);
+  }
+
+  /// @brief Apply one Kraus operator of `channel` to `psi`, drawn with its
+  /// probability, and renormalize.
+  static void applyKrausTrajectory(KetType &psi,
+                                   const cudaq::kraus_channel &channel,
+                                   const std::vector<std::size_t> &targets,
+                                   TrajectoryGenerator &gen) {
+    const double r = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+    if (channel.is_unitary_mixture()) {
+      // The probabilities are known upfront; apply the chosen unitary.
+      std::size_t k = 0;
+      double cumulative = channel.probabilities[0];
+      while (k + 1 < channel.probabilities.size() && r >= cumulative)
+        cumulative += channel.probabilities[++k];
+      const std::vector<std::complex<ScalarType>> matrix(
+          channel.unitary_ops[k].begin(), channel.unitary_ops[k].end());
+      applyKetGate(psi, matrix.data(), {}, targets);
+      return;
+    }
+
+    // General channel: branch k has probability ||K_k psi||^2, which is
+    // only known after applying K_k.
+    const auto &ops = channel.get_ops();
+    KetType branch;
+    double cumulative = 0.0;
+    for (std::size_t k = 0; k < ops.size(); ++k) {
+      const std::vector<std::complex<ScalarType>> matrix(ops[k].data.begin(),
+                                                         ops[k].data.end());
+      branch = psi;
+      applyKetGate(branch, matrix.data(), {}, targets);
+      const double prob = nvqir::kernels::squaredNorm(
+          branch.data(), static_cast<std::size_t>(branch.size()));
+      cumulative += prob;
+      // Round-off can leave `r` just above the total; take the last branch.
+      if (prob > 0.0 && (r < cumulative || k + 1 == ops.size())) {
+        const auto scale = static_cast<ScalarType>(1.0 / std::sqrt(prob));
+        nvqir::kernels::scaleState(
+            branch.data(), static_cast<std::size_t>(branch.size()), scale);
+        psi.swap(branch);
+        return;
+      }
+    }
+  }
+
+  /// @brief Apply `channel` to the current trajectory and record it.
+  void applyKrausChannel(const cudaq::kraus_channel &channel,
+                         const std::vector<std::size_t> &targets) {
+    restoreLayout();
+    applyKrausTrajectory(state, channel, targets,
+                         qpp::RandomDevices::get_instance().get_prng());
+    trajectoryHasNoise = true;
+    recordTrajectoryOp([channel, targets](KetType &psi,
+                                          TrajectoryGenerator &gen) {
+      applyKrausTrajectory(psi, channel, targets, gen);
+    });
+  }
+
+  /// @brief Number of trajectories to average over, at most `maxUseful`.
+  std::size_t numTrajectories(std::size_t maxUseful) const {
+    if (!recordingTrajectory || !trajectoryHasNoise)
+      return 1;
+    const std::size_t requested =
+        executionContext && executionContext->numberTrajectories
+            ? *executionContext->numberTrajectories
+            : defaultNumTrajectories;
+    return std::clamp<std::size_t>(requested, 1, maxUseful);
+  }
+
+  /// @brief Call `fn(t, psi, gen)` for `count` trajectories of the recorded
+  /// circuit. The first one is the current state; the others are replayed.
+  /// Each trajectory gets its own generator, seeded serially from the Q++
+  /// generator, so results do not depend on the number of threads.
+  template <typename TrajectoryFn>
+  void forEachTrajectory(std::size_t count, TrajectoryFn &&fn) {
+    auto &prng = qpp::RandomDevices::get_instance().get_prng();
+    std::vector<typename TrajectoryGenerator::result_type> seeds(count);
+    for (auto &seed : seeds)
+      seed = prng();
+
+    TrajectoryGenerator firstGen(seeds[0]);
+    fn(std::size_t(0), static_cast<const KetType &>(state), firstGen);
+    [[maybe_unused]] const bool concurrent =
+        static_cast<std::size_t>(state.size()) < maxConcurrentTrajectoryDim;
+#if defined(_OPENMP)
+#pragma omp parallel if (concurrent && count > 2)
+#endif
+    {
+      KetType psi;
+#if defined(_OPENMP)
+#pragma omp for schedule(dynamic)
+#endif
+      for (std::size_t t = 1; t < count; ++t) {
+        TrajectoryGenerator gen(seeds[t]);
+        for (const auto &op : trajectoryLog)
+          op(psi, gen);
+        fn(t, static_cast<const KetType &>(psi), gen);
+      }
+    }
+  }
+
+  /// @brief A gate of the deterministic prefix of a shot, with the number of
+  /// qubits of the state it was applied to.
+  struct PrefixGate {
+    std::size_t numQubits;
+    GateApplicationTask task;
+
+    bool operator==(const PrefixGate &other) const {
+      return numQubits == other.numQubits &&
+             task.matrix == other.task.matrix &&
+             task.controls == other.task.controls &&
+             task.targets == other.task.targets;
+    }
+  };
+
+  /// @brief Kernels with conditionals on measurement results are sampled
+  /// shot by shot, each shot re-executing the kernel from |0...0>. Everything
+  /// up to the first measurement of a shot is deterministic, so the state at
+  /// that point is kept in `checkpointState`, along with the gates that
+  /// produced it. Later shots defer their gates while they match these, and
+  /// restore the checkpoint instead of simulating them at the first
+  /// measurement.
+  bool usePrefixCheckpoint = true;
+  std::vector<PrefixGate> checkpointGates;
+  StateType checkpointState;
+
+  /// @brief Gates applied (or deferred) since the state of the current shot
+  /// was allocated, until its first measurement.
+  std::vector<PrefixGate> prefixGates;
+
+  /// @brief True while the gates of the current shot are being recorded.
+  bool trackingPrefix = false;
+
+  /// @brief True while the recorded gates match the checkpoint and have not
+  /// been applied to the state yet.
+  bool deferringPrefix = false;
+
+  /// @brief Start tracking the prefix of a shot whose state was just
+  /// allocated as |0...0>, if shots run one by one because of conditionals.
+  void startPrefix() {
+    prefixGates.clear();
+    const bool usable = usePrefixCheckpoint && executionContext &&
+                        executionContext->name == "sample" &&
+                        executionContext->hasConditionalsOnMeasureResults &&
+                        !executionContext->noiseModel;
+    if (!usable)
+      dropPrefixCheckpoint();
+    // With measurement branching, the checkpoint serves the branches whose
+    // state could not be saved. A branch with a saved state skips its gates
+    // up to that state anyway.
+    trackingPrefix = usable && !skippingBranchPrefix;
+    deferringPrefix = trackingPrefix && !checkpointGates.empty();
+  }
+
+  void dropPrefixCheckpoint() {
+    checkpointGates.clear();
+    if (checkpointState.size() != 0)
+      statePool.release(std::move(checkpointState));
+    checkpointState = StateType();
+  }
+
+  /// @brief Record `task` as part of the prefix. Return false if applying it
+  /// is deferred because it matches the checkpoint.
+  bool recordPrefixGate(const GateApplicationTask &task) {
+    PrefixGate gate{numQubitsInState(), task};
+    if (deferringPrefix) {
+      if (prefixGates.size() < checkpointGates.size() &&
+          checkpointGates[prefixGates.size()] == gate) {
+        prefixGates.push_back(std::move(gate));
+        return false;
+      }
+      // This shot takes a different path: catch up before applying `task`.
+      applyDeferredPrefix();
+    }
+    prefixGates.push_back(std::move(gate));
+    return true;
+  }
+
+  /// @brief Apply the deferred gates, e.g., before the state is read.
+  void applyDeferredPrefix() {
+    if (!deferringPrefix)
+      return;
+    deferringPrefix = false;
+    // The state is still |0...0>: the qubits allocated since the prefix
+    // started are all in |0>.
+    trackingPrefix = false;
+    for (const auto &gate : prefixGates)
+      applyGate(gate.task);
+    trackingPrefix = true;
+  }
+
+  /// @brief Stop tracking the prefix of the current shot because of an
+  /// operation that is not a gate, e.g., a noise channel or reading the state.
+  void stopPrefix() {
+    applyDeferredPrefix();
+    trackingPrefix = false;
+  }
+
+  /// @brief End the prefix of the current shot, right before its first
+  /// measurement. Restore the checkpoint if the prefix matches it, otherwise
+  /// take a new one.
+  void checkpointPrefix() {
+    if (!trackingPrefix)
+      return;
+    trackingPrefix = false;
+    if (deferringPrefix && prefixGates == checkpointGates &&
+        checkpointState.rows() == state.rows()) {
+      deferringPrefix = false;
+      cudaq::info("Restoring the state checkpoint after {} gates.",
+                  prefixGates.size());
+      state = checkpointState;
+      return;
+    }
+    applyDeferredPrefix();
+    // Only worth it if there are gates to skip in later shots.
+    if (prefixGates.empty()) {
+      dropPrefixCheckpoint();
+      return;
+    }
+    checkpointGates = std::move(prefixGates);
+    checkpointState = state;
+    prefixGates.clear();
+  }
+
   /// @brief Convert internal qubit index to Q++ qubit index.
   ///
   /// In Q++, qubits are indexed from left to right, and thus q0 is the leftmost
@@ -147,43 +596,84 @@ protected:
   double calculateExpectationValue(const std::vector<std::size_t> &qubits) {
     std::size_t bitmask = 0;
     for (auto q : qubits)
-      bitmask |= (1ULL << q);
-    const auto hasEvenParity = [&bitmask](std::size_t x) -> bool {
-      return std::popcount(x & bitmask) % 2 == 0;
-    };
+      bitmask |= (1ULL << physicalQubit(q));
+    const std::size_t dim = state.rows();
+    const auto *data = state.data();
+    return nvqir::kernels::reduceSum(dim, [=](std::size_t i) {
+      double probability;
+      if constexpr (isKet)
+        probability = std::norm(data[i]);
+      else
+        probability = data[i * dim + i].real();
+      return std::popcount(i & bitmask) % 2 == 0 ? probability : -probability;
+    });
+  }
 
-    std::vector<double> result;
-    if constexpr (std::is_same_v<StateType, qpp::ket>) {
-      result.resize(stateDimension);
-#if defined(_OPENMP)
-#pragma omp parallel for
-#endif
-      for (std::size_t i = 0; i < stateDimension; ++i)
-        result[i] = (hasEvenParity(i) ? 1.0 : -1.0) * std::norm(state[i]);
-    } else if constexpr (std::is_same_v<StateType, qpp::cmat>) {
-      Eigen::VectorXcd diag = state.diagonal();
-      result.resize(state.rows());
-#if defined(_OPENMP)
-#pragma omp parallel for
-#endif
-      for (Eigen::Index i = 0; i < state.rows(); ++i)
-        result[i] = hasEvenParity(i) ? diag(i).real() : -diag(i).real();
+  /// @brief Grow the state by `qubitCount` new (most significant) qubits in
+  /// the state given by `factor`: a state vector, or a column-major density
+  /// matrix for density matrix simulation. A null `factor` means |0...0>.
+  ///
+  /// This computes `kron(factor, state)` in place: the storage is
+  /// reallocated once, keeping the current state at its start, and then
+  /// expanded from the back without a full-size temporary.
+  static void growState(StateType &target, std::size_t qubitCount,
+                        const std::complex<ScalarType> *factor) {
+    const std::size_t oldDim = target.rows();
+    const std::size_t factorDim = 1ULL << qubitCount;
+    if constexpr (isKet) {
+      target.conservativeResize(oldDim * factorDim);
+      nvqir::kernels::growState(target.data(), oldDim, factor, factorDim);
+    } else {
+      // Keeping the row count lets Eigen reallocate the column-major storage
+      // without moving the existing elements. Resizing to the same total
+      // size then only changes the dimensions.
+      const std::size_t newDim = oldDim * factorDim;
+      target.conservativeResize(oldDim, newDim * factorDim);
+      target.resize(newDim, newDim);
+      nvqir::kernels::growDensityMatrix(target.data(), oldDim, factor,
+                                        factorDim);
     }
-
-    // Accumulate outside the for loop to ensure repeatability
-    return std::accumulate(result.begin(), result.end(), 0.0);
   }
 
-  qpp::cmat toQppMatrix(const std::vector<std::complex<double>> &data,
-                        std::size_t nTargets) {
-    auto nRows = (1UL << nTargets);
-    assert(data.size() == nRows * nRows &&
-           "Invalid number of gate matrix elements passed to toQppMatrix");
+  void growStateInPlace(std::size_t qubitCount,
+                        const std::complex<ScalarType> *factor) {
+    // Qubits allocated in |0> keep the deferred prefix valid.
+    if (factor)
+      stopPrefix();
+    const std::size_t oldQubits = numQubitsInState();
+    growState(state, qubitCount, factor);
+    if (layout.size() != 0)
+      layout.insert(oldQubits, qubitCount);
+    if constexpr (isKet) {
+      std::vector<std::complex<ScalarType>> factorData;
+      if (factor)
+        factorData.assign(factor, factor + (1ULL << qubitCount));
+      recordTrajectoryOp([qubitCount, factorData](KetType &psi,
+                                                  TrajectoryGenerator &) {
+        growState(psi, qubitCount,
+                  factorData.empty() ? nullptr : factorData.data());
+      });
+    }
+  }
 
-    // we represent row major, they represent column major
-    return Eigen::Map<Eigen::Matrix<std::complex<double>, Eigen::Dynamic,
-                                    Eigen::Dynamic, Eigen::RowMajor>>(
-        const_cast<std::complex<double> *>(data.data()), nRows, nRows);
+  /// @brief Start recording for a state allocated from scratch, either as
+  /// |0...0> or from `data`.
+  void recordInitialState(const std::complex<ScalarType> *data) {
+    startTrajectoryLog();
+    if (!recordingTrajectory)
+      return;
+    const std::size_t dim = state.size();
+    if (!data) {
+      recordTrajectoryOp([dim](KetType &psi, TrajectoryGenerator &) {
+        psi.setZero(dim);
+        psi(0) = 1.0;
+      });
+      return;
+    }
+    recordTrajectoryOp([initial = KetType(KetType::Map(data, dim))](
+                           KetType &psi, TrajectoryGenerator &) {
+      psi = initial;
+    });
   }
 
   /// @brief Grow the state vector by one qubit.
@@ -196,105 +686,433 @@ protected:
     if (qubitCount == 0)
       return;
 
-    auto *stateData = reinterpret_cast<std::complex<double> *>(
+    auto *stateData = reinterpret_cast<std::complex<ScalarType> *>(
         const_cast<void *>(stateDataIn));
 
     if (state.size() == 0) {
       // If this is the first time, allocate the state
       if (stateData == nullptr) {
-        state = qpp::ket::Zero(stateDimension);
-        state(0) = 1.0;
-      } else
-        state = qpp::ket::Map(stateData, stateDimension);
+        allocateZeroState();
+        startPrefix();
+      } else {
+        state = KetType::Map(stateData, stateDimension);
+      }
+      if constexpr (isKet)
+        recordInitialState(stateData);
       return;
     }
-    // If we are resizing an existing, allocate
-    // a zero state on a n qubit, and Kron-prod
-    // that with the existing state.
-    if (stateData == nullptr) {
-      qpp::ket zero_state = qpp::ket::Zero((1UL << qubitCount));
-      zero_state(0) = 1.0;
-      state = qpp::kron(zero_state, state);
-    } else {
-      qpp::ket initState = qpp::ket::Map(stateData, (1UL << qubitCount));
-      state = qpp::kron(initState, state);
-    }
-    return;
+    // Grow the existing state in place, with the new qubits in |0> or in
+    // the provided state.
+    growStateInPlace(qubitCount, stateData);
   }
 
   void addQubitsToState(const cudaq::SimulationState &in_state) override {
-    const QppState *const casted = dynamic_cast<const QppState *>(&in_state);
+    const auto *const casted =
+        dynamic_cast<const QppState<ScalarType> *>(&in_state);
     if (!casted)
       throw std::invalid_argument(
           "[QppCircuitSimulator] Incompatible state input");
 
-    if (state.size() == 0)
-      state = casted->state;
-    else
-      state = qpp::kron(casted->state, state);
+    if (state.size() != 0) {
+      growStateInPlace(casted->getNumQubits(), casted->state.data());
+      return;
+    }
+    state = casted->state;
+    if constexpr (isKet)
+      recordInitialState(casted->state.data());
   }
 
   /// @brief Reset the qubit state.
   void deallocateStateImpl() override {
-    StateType tmp;
-    state = tmp;
+    statePool.release(std::move(state));
+    state = StateType();
+    layout.reset(0);
+    trajectoryLog.clear();
+    recordingTrajectory = false;
+    trackingPrefix = false;
+    deferringPrefix = false;
   }
 
-  void applyGate(const GateApplicationTask &task) override {
-    auto matrix = toQppMatrix(task.matrix, task.targets.size());
-    // First, convert all of the qubit indices to big endian.
-    std::vector<std::size_t> controls;
-    for (auto index : task.controls) {
-      controls.push_back(convertQubitIndex(index));
+  /// @brief Project the last qubit, in the basis state |value>, out of the
+  /// state into a pooled buffer of half the size (a quarter for a density
+  /// matrix). Not while the prefix or a trajectory is recorded, which replay
+  /// gates on states of the recorded size.
+  bool removeQubitFromState(std::size_t index, bool value) override {
+    const std::size_t numQubits = numQubitsInState();
+    if (trackingPrefix || recordingTrajectory || index + 1 != numQubits)
+      return false;
+    flushGateQueue();
+
+    StateType reduced;
+    if constexpr (isKet) {
+      const std::size_t position = physicalQubit(index);
+      reduced = statePool.acquire(state.rows() / 2, 1);
+      nvqir::kernels::removeBits(state.data(), numQubits, {position},
+                                 std::size_t(value) << position,
+                                 reduced.data());
+      if (layout.size() != 0)
+        layout.removeLast();
+    } else {
+      const std::size_t dim = state.rows() / 2;
+      const std::size_t bits = (1ULL << index) | (1ULL << (index + numQubits));
+      reduced = statePool.acquire(dim, dim);
+      nvqir::kernels::removeBits(state.data(), 2 * numQubits,
+                                 {index, index + numQubits},
+                                 value ? bits : 0, reduced.data());
     }
-    std::vector<std::size_t> targets;
-    for (auto index : task.targets) {
-      targets.push_back(convertQubitIndex(index));
+    statePool.release(std::move(state));
+    state = std::move(reduced);
+    return true;
+  }
+
+  /// @brief Apply the queued gates cache-blocked if nothing needs to see
+  /// them one by one: noise channels, the prefix checkpoint and measurement
+  /// branching all work gate by gate on the CUDA-Q qubit order.
+  void flushGateQueueImpl() override {
+    if constexpr (isKet) {
+      const std::size_t numQubits = numQubitsInState();
+      if (blockQubits > 0 && numQubits > blockQubits && !trackingPrefix &&
+          !recordingTrajectory && !branchingMeasurements &&
+          !(executionContext && executionContext->noiseModel)) {
+        if (maxFusedQubits > 1 && gateQueue.size() > 1)
+          fuseGateQueue();
+        std::vector<GateApplicationTask> gates;
+        gates.reserve(gateQueue.size());
+        while (!gateQueue.empty()) {
+          const auto &next = gateQueue.front();
+          if (summaryData.enabled)
+            summaryData.svGateUpdate(
+                next.controls.size(), next.targets.size(), stateDimension,
+                stateDimension * sizeof(std::complex<ScalarType>));
+          gates.push_back(next);
+          gateQueue.pop();
+        }
+        if (layout.size() == 0)
+          layout.reset(numQubits);
+        nvqir::kernels::applyGatesBlocked(state.data(), numQubits,
+                                          blockQubits, layout, gates,
+                                          [](std::size_t, std::size_t) {});
+        return;
+      }
     }
+    restoreLayout();
+    nvqir::CircuitSimulatorBase<ScalarType>::flushGateQueueImpl();
+  }
 
-    if (controls.empty()) {
-      state = qpp::apply(state, matrix, targets);
+  void applyGate(const GateApplicationTask &task) override {
+    if (trackingPrefix && !recordPrefixGate(task))
       return;
+    if constexpr (isKet) {
+      // Apply the gate in place with the native kernels. These use the CUDA-Q
+      // qubit indexing directly, no conversion is needed.
+      const std::size_t numQubits =
+          std::countr_zero(static_cast<std::size_t>(state.size()));
+      nvqir::kernels::applyGate(state.data(), numQubits, task.matrix.data(),
+                                task.controls, task.targets);
+      recordTrajectoryOp([matrix = task.matrix, controls = task.controls,
+                          targets = task.targets](KetType &psi,
+                                                  TrajectoryGenerator &) {
+        applyKetGate(psi, matrix.data(), controls, targets);
+      });
+    } else {
+      // rho -> U rho U^dagger. The density matrix is simulated as a vector
+      // of 2n qubits: seen as a vector, the column-major density matrix has
+      // the row index in the low bits and the column index in the high bits,
+      // so this applies U on the former and conj(U) on the latter.
+      const std::size_t numQubits = numQubitsInState();
+      std::vector<std::size_t> colControls, colTargets;
+      for (auto index : task.controls)
+        colControls.push_back(index + numQubits);
+      for (auto index : task.targets)
+        colTargets.push_back(index + numQubits);
+
+      if (auto monomial = nvqir::kernels::toMonomialGate(
+              task.matrix.data(), 1ULL << task.targets.size())) {
+        nvqir::kernels::applyMonomialGate(state.data(), 2 * numQubits,
+                                          *monomial, task.controls,
+                                          task.targets);
+        for (auto &phase : monomial->phases)
+          phase = std::conj(phase);
+        nvqir::kernels::applyMonomialGate(state.data(), 2 * numQubits,
+                                          *monomial, colControls, colTargets);
+        return;
+      }
+
+      if (task.controls.empty() && task.targets.size() == 1) {
+        // A dense single-qubit gate is applied in one sweep, as the
+        // two-qubit gate kron(conj(U), U) on (column bit, row bit).
+        std::complex<ScalarType> superop[16];
+        for (std::size_t ar = 0; ar < 2; ++ar)
+          for (std::size_t br = 0; br < 2; ++br)
+            for (std::size_t ac = 0; ac < 2; ++ac)
+              for (std::size_t bc = 0; bc < 2; ++bc)
+                superop[(ar * 2 + br) * 4 + ac * 2 + bc] =
+                    std::conj(task.matrix[ar * 2 + ac]) *
+                    task.matrix[br * 2 + bc];
+        nvqir::kernels::applyGate(state.data(), 2 * numQubits, superop, {},
+                                  {colTargets[0], task.targets[0]});
+        return;
+      }
+
+      nvqir::kernels::applyGate(state.data(), 2 * numQubits,
+                                task.matrix.data(), task.controls,
+                                task.targets);
+      std::vector<std::complex<ScalarType>> conjMatrix(task.matrix.size());
+      std::transform(task.matrix.begin(), task.matrix.end(),
+                     conjMatrix.begin(),
+                     [](const auto &element) { return std::conj(element); });
+      nvqir::kernels::applyGate(state.data(), 2 * numQubits,
+                                conjMatrix.data(), colControls, colTargets);
+    }
+  }
+
+  /// @brief If we have a noise model, apply one trajectory of each
+  /// kraus_channel specified for the given gate name on the provided qubits.
+  void applyNoiseChannel(const std::string_view gateName,
+                         const std::vector<std::size_t> &controls,
+                         const std::vector<std::size_t> &targets,
+                         const std::vector<double> &params) override {
+    if constexpr (isKet) {
+      // Do nothing if no execution context or no noise model
+      if (!executionContext || !executionContext->noiseModel)
+        return;
+
+      std::vector<std::size_t> qubits{controls.begin(), controls.end()};
+      qubits.insert(qubits.end(), targets.begin(), targets.end());
+      auto krausChannels = executionContext->noiseModel->get_channels(
+          std::string(gateName), targets, controls, params);
+      if (krausChannels.empty())
+        return;
+
+      CUDAQ_INFO("Applying {} kraus channels to qubits {}",
+                 krausChannels.size(), qubits);
+      for (const auto &channel : krausChannels)
+        applyKrausChannel(channel, qubits);
+    }
+  }
+
+  /// @brief The state vector simulator samples a Kraus operator of any
+  /// channel per trajectory.
+  bool isValidNoiseChannel(const cudaq::noise_model_type &type) const override {
+    return isKet;
+  }
+
+  /// @brief Apply one trajectory of the given noise channel.
+  void applyNoise(const cudaq::kraus_channel &channel,
+                  const std::vector<std::size_t> &qubits) override {
+    if constexpr (isKet) {
+      flushGateQueue();
+      stopPrefix();
+      CUDAQ_INFO("[qpp] apply kraus channel {}", channel.get_type_name());
+      applyKrausChannel(channel, qubits);
+      for (auto q : qubits)
+        setBasisState(q, std::nullopt);
+    } else {
+      nvqir::CircuitSimulator::applyNoise(channel, qubits);
     }
-    state = qpp::applyCTRL(state, matrix, controls, targets);
   }
 
   /// @brief Set the current state back to the |0> state.
   void setToZeroState() override {
-    state = qpp::ket::Zero(stateDimension);
-    state(0) = 1.0;
+    trackingPrefix = false;
+    deferringPrefix = false;
+    layout.reset(0);
+    if (static_cast<std::size_t>(state.rows()) == stateDimension) {
+      nvqir::kernels::clearState(state.data(), state.size());
+      state(0) = 1.0;
+    } else {
+      allocateZeroState();
+    }
+    // Batch mode keeps recording as decided when the state was allocated.
+    trajectoryLog.clear();
+    trajectoryHasNoise = false;
+    recordTrajectoryOp([dim = stateDimension](KetType &psi,
+                                              TrajectoryGenerator &) {
+      psi.setZero(dim);
+      psi(0) = 1.0;
+    });
+  }
+
+  /// @brief Return the number of qubits in the current state.
+  std::size_t numQubitsInState() const {
+    return std::countr_zero(static_cast<std::size_t>(state.rows()));
+  }
+
+  /// @brief Probability of measuring 1 on the qubit at (CUDA-Q) `index`.
+  static double probabilityOfOne(const StateType &target,
+                                 const std::size_t index) {
+    double probOne = 0.0;
+    if constexpr (isKet)
+      probOne = nvqir::kernels::probabilityOfOne(
+          target.data(),
+          std::countr_zero(static_cast<std::size_t>(target.rows())), index);
+    else
+      probOne = nvqir::kernels::probabilityOfOneDiagonal(
+          target.data(), target.rows(), index);
+    return std::clamp(probOne, 0.0, 1.0);
+  }
+
+  /// @brief Project the qubit at (CUDA-Q) `index` onto `result`, which has
+  /// probability `outcomeProb`, in place. If `resetToZero` is set, the qubit
+  /// is also flipped back to |0> as part of the same pass.
+  static void collapseInPlace(StateType &target, const std::size_t index,
+                              bool result, double outcomeProb,
+                              bool resetToZero) {
+    const std::size_t numQubits =
+        std::countr_zero(static_cast<std::size_t>(target.rows()));
+    if constexpr (isKet) {
+      nvqir::kernels::collapse(
+          target.data(), numQubits, {index}, result ? (1ULL << index) : 0,
+          static_cast<ScalarType>(1.0 / std::sqrt(outcomeProb)), resetToZero);
+    } else {
+      // Seen as a vector, the (column-major) density matrix has the row index
+      // in the low bits and the column index in the high bits.
+      const std::size_t rowBit = index;
+      const std::size_t colBit = index + numQubits;
+      nvqir::kernels::collapse(
+          target.data(), 2 * numQubits, {rowBit, colBit},
+          result ? ((1ULL << rowBit) | (1ULL << colBit)) : 0,
+          1.0 / outcomeProb, resetToZero);
+    }
+  }
+
+  /// @brief Measure the qubit at (CUDA-Q) `index` in the computational basis,
+  /// collapsing the state in place. If `resetToZero` is set, the qubit is
+  /// also flipped back to |0> as part of the same pass. Return the outcome.
+  static bool measureInPlace(StateType &target, const std::size_t index,
+                             bool resetToZero, TrajectoryGenerator &gen) {
+    const double probOne = probabilityOfOne(target, index);
+    std::discrete_distribution<int> outcomeDistribution{1.0 - probOne,
+                                                        probOne};
+    const bool result = outcomeDistribution(gen) == 1;
+    collapseInPlace(target, index, result, result ? probOne : 1.0 - probOne,
+                    resetToZero);
+    return result;
+  }
+
+  bool measureInPlace(const std::size_t index, bool resetToZero) {
+    // Draw the outcome from the Q++ generator so that `setRandomSeed` keeps
+    // controlling the measurement results.
+    const bool result =
+        measureInPlace(state, physicalQubit(index), resetToZero,
+                       qpp::RandomDevices::get_instance().get_prng());
+    // Other trajectories draw their own outcomes. Measurement results only
+    // feed back into the circuit with conditionals, which run shot by shot.
+    if constexpr (isKet)
+      recordTrajectoryOp([index, resetToZero](KetType &psi,
+                                              TrajectoryGenerator &gen) {
+        measureInPlace(psi, index, resetToZero, gen);
+      });
+    return result;
   }
 
   /// @brief Measure the qubit and return the result. Collapse the
   /// state vector.
   bool measureQubit(const std::size_t index) override {
-    const auto qubitIdx = convertQubitIndex(index);
-    // If here, then we care about the result bit, so compute it.
-    const auto measurement_tuple =
-        qpp::measure(state, qpp::cmat::Identity(2, 2), {qubitIdx},
-                     /*qudit dimension=*/2, /*destructive measmt=*/false);
-    const auto measurement_result = std::get<qpp::RES>(measurement_tuple);
-    const auto &post_meas_states = std::get<qpp::ST>(measurement_tuple);
-    const auto &collapsed_state = post_meas_states[measurement_result];
-    if constexpr (std::is_same_v<StateType, qpp::ket>) {
-      state = Eigen::Map<const StateType>(collapsed_state.data(),
-                                          collapsed_state.size());
-    } else {
-      state = Eigen::Map<const StateType>(collapsed_state.data(),
-                                          collapsed_state.rows(),
-                                          collapsed_state.cols());
-    }
-    cudaq::info("Measured qubit {} -> {}", qubitIdx, measurement_result);
-    return measurement_result == 1 ? true : false;
+    checkpointPrefix();
+    const bool result = measureInPlace(index, /*resetToZero=*/false);
+    cudaq::info("Measured qubit {} -> {}", index, result);
+    return result;
   }
 
   QubitOrdering getQubitOrdering() const override { return QubitOrdering::msb; }
 
+  /// @brief States saved at measurement branches, by slot.
+  std::vector<StateType> branchStates;
+
+  bool supportsMeasurementBranching() const override { return true; }
+
+  std::size_t splitShotsOnMeasurement(const std::size_t index,
+                                      const std::size_t shots) override {
+    checkpointPrefix();
+    std::binomial_distribution<std::size_t> ones(
+        shots, probabilityOfOne(state, physicalQubit(index)));
+    return ones(qpp::RandomDevices::get_instance().get_prng());
+  }
+
+  void collapseQubit(const std::size_t index, bool outcome,
+                     bool resetToZero) override {
+    checkpointPrefix();
+    const std::size_t position = physicalQubit(index);
+    const double probOne = probabilityOfOne(state, position);
+    collapseInPlace(state, position, outcome,
+                    outcome ? probOne : 1.0 - probOne, resetToZero);
+  }
+
+  /// @brief Saved states share the memory budget of the state pool. Without
+  /// a saved state, a branch is simulated again from the start.
+  bool saveBranchState(const std::size_t slot) override {
+    std::size_t savedBytes = 0;
+    for (const auto &saved : branchStates)
+      savedBytes += saved.size() * sizeof(std::complex<ScalarType>);
+    if (savedBytes + state.size() * sizeof(std::complex<ScalarType>) >
+        statePool.capacityBytes())
+      return false;
+    if (branchStates.size() <= slot)
+      branchStates.resize(slot + 1);
+    branchStates[slot] = state;
+    return true;
+  }
+
+  void restoreBranchState(const std::size_t slot) override {
+    statePool.release(std::move(state));
+    state = std::move(branchStates[slot]);
+    branchStates[slot] = StateType();
+  }
+
+  void clearBranchStates() override { branchStates.clear(); }
+
 public:
   QppCircuitSimulator() {
     // Populate the correct name so it is printed correctly during
     // deconstructor.
     summaryData.name = name();
+
+    // Gate fusion is opt-in for the CPU simulators.
+    if (auto *fusionEnvVar = std::getenv("CUDAQ_FUSION_MAX_QUBITS")) {
+      const int fusionMaxQubits = std::atoi(fusionEnvVar);
+      if (fusionMaxQubits <= 0)
+        throw std::runtime_error(
+            fmt::format("Invalid CUDAQ_FUSION_MAX_QUBITS environment variable "
+                        "setting. Expecting a positive integer value, got "
+                        "'{}'.",
+                        fusionEnvVar));
+      cudaq::info("Enabling gate fusion up to {} qubits.", fusionMaxQubits);
+      maxFusedQubits = fusionMaxQubits;
+    }
+
+    // Blocks of 2^n amplitudes for cache-blocked gate application, or 0 to
+    // apply gates one by one.
+    if (auto *blockEnvVar = std::getenv("CUDAQ_CACHE_BLOCK_QUBITS")) {
+      const int block = std::atoi(blockEnvVar);
+      if (block < 0 || block >= 64 ||
+          (block == 0 && std::string(blockEnvVar) != "0"))
+        throw std::runtime_error(
+            fmt::format("Invalid CUDAQ_CACHE_BLOCK_QUBITS environment "
+                        "variable setting. Expecting a non-negative integer "
+                        "value, got '{}'.",
+                        blockEnvVar));
+      cudaq::info("Applying gates in cache blocks of {} qubits.", block);
+      blockQubits = block;
+    }
+
+    // Released state buffers are kept for reuse up to this many GB. By
+    // default, the pool grows with the largest state simulated.
+    std::optional<std::size_t> poolMemoryBytes;
+    if (auto *poolEnvVar = std::getenv("CUDAQ_STATE_POOL_MEMORY_GB")) {
+      const int poolGB = std::atoi(poolEnvVar);
+      if (poolGB < 0 || (poolGB == 0 && std::string(poolEnvVar) != "0"))
+        throw std::runtime_error(
+            fmt::format("Invalid CUDAQ_STATE_POOL_MEMORY_GB environment "
+                        "variable setting. Expecting a non-negative integer "
+                        "value, got '{}'.",
+                        poolEnvVar));
+      cudaq::info("Setting the state buffer pool size to {} GB.", poolGB);
+      poolMemoryBytes = static_cast<std::size_t>(poolGB) << 30;
+    }
+    statePool.configure(poolMemoryBytes,
+                        cudaq::getEnvBool("CUDAQ_HUGE_PAGES", false));
+    usePrefixCheckpoint = cudaq::getEnvBool("CUDAQ_PREFIX_CHECKPOINT", true);
   }
   virtual ~QppCircuitSimulator() = default;
 
@@ -315,21 +1133,58 @@ public:
   cudaq::observe_result observe(const cudaq::spin_op &op) override {
     assert(cudaq::spin_op::canonicalize(op) == op);
     flushGateQueue();
+    stopPrefix();
 
-    // The op is on the following target bits.
-    auto targets = op.degrees();
+    const std::size_t numQubits = numQubitsInState();
+    std::vector<nvqir::kernels::PauliMasks> masks;
+    std::vector<std::complex<double>> coefficients;
+    toPauliMasks(op, numQubits, masks, coefficients);
+    // Evaluate the terms on the physical qubit positions of the state.
+    if (layout.size() != 0)
+      for (auto &termMasks : masks) {
+        termMasks.x = layout.physicalIndex(termMasks.x);
+        termMasks.z = layout.physicalIndex(termMasks.z);
+      }
 
-    // Get the matrix as an Eigen matrix
-    auto matrix = op.to_matrix();
-    qpp::cmat asEigen = matrix.as_eigen();
+    const auto expectation = [&](const StateType &target) {
+      std::vector<double> termValues;
+      const auto *data = target.data();
+      if constexpr (isKet) {
+        termValues = nvqir::kernels::pauliExpectations(
+            [data](std::size_t i, std::size_t x) {
+              return nvqir::kernels::cmul(std::conj(data[i ^ x]), data[i]);
+            },
+            numQubits, masks);
+      } else {
+        const std::size_t dim = target.rows();
+        termValues = nvqir::kernels::pauliExpectations(
+            [data, dim](std::size_t i, std::size_t x) {
+              return data[i + (i ^ x) * dim];
+            },
+            numQubits, masks);
+      }
+      double value = 0.0;
+      for (std::size_t t = 0; t < termValues.size(); ++t)
+        value += (coefficients[t] * termValues[t]).real();
+      return value;
+    };
 
-    // Compute the expected value
     double ee = 0.0;
-    if constexpr (std::is_same_v<StateType, qpp::ket>) {
-      qpp::ket k = qpp::apply(state, asEigen, targets, 2);
-      ee = state.dot(k).real();
-    } else {
-      ee = qpp::apply(asEigen, state, targets).trace().real();
+    const std::size_t count =
+        numTrajectories(std::numeric_limits<std::size_t>::max());
+    if (count == 1) {
+      ee = expectation(state);
+    } else if constexpr (isKet) {
+      // Average over the noise trajectories, summed in order.
+      cudaq::info("Computing <H> over {} noise trajectories.", count);
+      std::vector<double> trajectoryValues(count);
+      forEachTrajectory(count, [&](std::size_t t, const KetType &psi,
+                                   TrajectoryGenerator &) {
+        trajectoryValues[t] = expectation(psi);
+      });
+      for (const double value : trajectoryValues)
+        ee += value;
+      ee /= count;
     }
 
     return cudaq::observe_result(
@@ -342,71 +1197,97 @@ public:
   void resetQubit(const std::size_t index) override {
     flushGateQueue();
     flushAnySamplingTasks();
-    const auto qubitIdx = convertQubitIndex(index);
-    state = qpp::reset(state, {qubitIdx});
+    setBasisState(index, false);
+    if (branchingMeasurements) {
+      measureBranch(index, /*resetToZero=*/true);
+      return;
+    }
+    checkpointPrefix();
+    // Measure, then flip the qubit back to |0> if needed, in a single pass.
+    measureInPlace(index, /*resetToZero=*/true);
   }
 
   /// @brief Sample the multi-qubit state.
   cudaq::ExecutionResult sample(const std::vector<std::size_t> &qubits,
                                 const int shots) override {
+    flushGateQueue();
+    stopPrefix();
     if (shots < 1) {
       double expectationValue = calculateExpectationValue(qubits);
       cudaq::info("Computed expectation value = {}", expectationValue);
       return cudaq::ExecutionResult{{}, expectationValue};
     }
 
-    std::vector<std::size_t> measuredBits;
-    for (auto index : qubits) {
-      measuredBits.push_back(convertQubitIndex(index));
-    }
-
-    auto sampleResult = qpp::sample(shots, state, measuredBits, 2);
-    // Convert to what we expect
-    std::stringstream bitstream;
-    cudaq::ExecutionResult counts;
-
-    // Expectation value from the counts
-    double expVal = 0.0;
-    for (auto [result, count] : sampleResult) {
-      // Push back each term in the vector of bits to the bitstring.
-      for (const auto &bit : result) {
-        bitstream << bit;
+    const std::size_t numQubits = numQubitsInState();
+    auto &gen = qpp::RandomDevices::get_instance().get_prng();
+    std::vector<std::pair<std::uint64_t, std::size_t>> sampleResult;
+    if constexpr (isKet) {
+      std::vector<std::size_t> positions;
+      for (auto q : qubits)
+        positions.push_back(physicalQubit(q));
+      const auto sampleKet = [&](const KetType &psi, std::size_t psiShots,
+                                 TrajectoryGenerator &psiGen) {
+        const auto *amplitudes = psi.data();
+        return nvqir::kernels::sampleOutcomes(
+            [amplitudes](std::size_t i) { return std::norm(amplitudes[i]); },
+            numQubits, positions, psiShots, psiGen);
+      };
+      const std::size_t count = numTrajectories(shots);
+      if (count == 1) {
+        sampleResult = sampleKet(state, shots, gen);
+      } else {
+        // Split the shots evenly over the noise trajectories.
+        cudaq::info("Sampling {} shots over {} noise trajectories.", shots,
+                    count);
+        std::vector<std::vector<std::pair<std::uint64_t, std::size_t>>>
+            trajectoryResults(count);
+        forEachTrajectory(count, [&](std::size_t t, const KetType &psi,
+                                     TrajectoryGenerator &psiGen) {
+          const std::size_t psiShots = shots / count + (t < shots % count);
+          trajectoryResults[t] = sampleKet(psi, psiShots, psiGen);
+        });
+        std::map<std::uint64_t, std::size_t> merged;
+        for (const auto &result : trajectoryResults)
+          for (auto [key, keyCount] : result)
+            merged[key] += keyCount;
+        sampleResult.assign(merged.begin(), merged.end());
       }
-
-      // Add to the sample result
-      // in mid-circ sampling mode this will append 1 bitstring
-      auto bitstring = bitstream.str();
-      counts.appendResult(bitstring, count);
-      auto par = cudaq::sample_result::has_even_parity(bitstring);
-      auto p = count / (double)shots;
-      if (!par) {
-        p = -p;
-      }
-      expVal += p;
-      // Reset the state.
-      bitstream.str("");
-      bitstream.clear();
+    } else {
+      // The diagonal of the column-major density matrix, with round-off
+      // negatives clamped.
+      const auto *rho = state.data();
+      const std::size_t stride = state.rows() + 1;
+      sampleResult = nvqir::kernels::sampleOutcomes(
+          [rho, stride](std::size_t i) {
+            return std::max(0.0, rho[i * stride].real());
+          },
+          numQubits, qubits, shots, gen);
     }
 
-    counts.expectationValue = expVal;
-    return counts;
+    return toExecutionResult(sampleResult, qubits.size(), shots);
   }
 
   std::unique_ptr<cudaq::SimulationState> getSimulationState() override {
     flushGateQueue();
-    return std::make_unique<QppState>(std::move(state));
+    stopPrefix();
+    restoreLayout();
+    return std::make_unique<QppState<ScalarType>>(std::move(state));
   }
 
-  bool isStateVectorSimulator() const override {
-    return std::is_same_v<StateType, qpp::ket>;
-  }
+  bool isStateVectorSimulator() const override { return isKet; }
 
   /// @brief Primarily used for testing.
   auto getStateVector() {
     flushGateQueue();
+    stopPrefix();
+    restoreLayout();
     return state;
   }
-  std::string name() const override { return "qpp"; }
+  std::string name() const override {
+    if constexpr (std::is_same_v<ScalarType, float>)
+      return "qpp-fp32";
+    return "qpp";
+  }
   NVQIR_SIMULATOR_CLONE_IMPL(QppCircuitSimulator<StateType>)
 };
 
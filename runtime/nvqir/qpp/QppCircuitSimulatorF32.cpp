@@ -0,0 +1,14 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#define __NVQIR_QPP_TOGGLE_CREATE
+#include "QppCircuitSimulator.cpp"
+/// Register this Simulator with NVQIR.
+NVQIR_REGISTER_SIMULATOR(nvqir::QppCircuitSimulator<nvqir::QppKetFp32>,
+                         qpp_fp32)
+#undef __NVQIR_QPP_TOGGLE_CREATE
@@ -47,7 +47,9 @@ struct QppDmState : public cudaq::SimulationState {
     // For qubit systems, F(rho,sigma) = tr(rho*sigma) + 2 *
     // sqrt(det(rho)*det(sigma))
     auto detprod = rho.determinant() * sigma.determinant();
-    return (rho * sigma).trace().real() + 2 * std::sqrt(detprod.real());
+    return nvqir::kernels::traceOfProduct(rho.data(), sigma.data(), rho.rows())
+               .real() +
+           2 * std::sqrt(detprod.real());
   }
 
   std::complex<double>
@@ -133,6 +135,130 @@ struct QppDmState : public cudaq::SimulationState {
 class QppNoiseCircuitSimulator : public nvqir::QppCircuitSimulator<qpp::cmat> {
 
 protected:
+  /// @brief Row-major superoperator of a channel (or gate) on `k` qubits:
+  /// the `4^k x 4^k` matrix acting on the vectorized density matrix, with the
+  /// column bits of the element index above its row bits. For Kraus
+  /// operators `K_i` it is `sum_i kron(conj(K_i), K_i)`.
+  using Superoperator = Eigen::Matrix<std::complex<double>, Eigen::Dynamic,
+                                      Eigen::Dynamic, Eigen::RowMajor>;
+
+  /// @brief Largest gate, in qubits, whose noise channels are fused with it
+  /// into a single superoperator.
+  static constexpr std::size_t maxFusedNoiseQubits = 2;
+
+  /// @brief Superoperators of the channels applied so far, keyed by the
+  /// dimension and Kraus operator data of the channel.
+  std::map<std::vector<double>, Superoperator> superoperatorCache;
+
+  /// @brief Set when `applyGate` already applied the noise channels of the
+  /// gate, fused with it, so the `applyNoiseChannel` call that follows it
+  /// must not apply them again.
+  bool gateNoiseApplied = false;
+
+  /// @brief Accumulate `kron(conj(A), B)` for the row-major `dim x dim`
+  /// matrices `A` and `B` into `superop`.
+  static void addSuperoperatorTerm(Superoperator &superop,
+                                   const std::complex<double> *A,
+                                   const std::complex<double> *B,
+                                   std::size_t dim) {
+    for (std::size_t ar = 0; ar < dim; ++ar)
+      for (std::size_t br = 0; br < dim; ++br)
+        for (std::size_t ac = 0; ac < dim; ++ac)
+          for (std::size_t bc = 0; bc < dim; ++bc)
+            superop(ar * dim + br, ac * dim + bc) +=
+                std::conj(A[ar * dim + ac]) * B[br * dim + bc];
+  }
+
+  /// @brief The (cached) superoperator of `channel` acting on `numQubits`.
+  const Superoperator &getSuperoperator(const cudaq::kraus_channel &channel,
+                                        std::size_t numQubits) {
+    const std::size_t dim = channel.dimension();
+    if (dim != (1ULL << numQubits))
+      throw std::runtime_error(fmt::format(
+          "[qpp-dm] kraus channel {} of dimension {} cannot be applied to {} "
+          "qubits.",
+          channel.get_type_name(), dim, numQubits));
+
+    const auto &ops = channel.get_ops();
+    std::vector<double> key{static_cast<double>(dim)};
+    key.reserve(1 + 2 * ops.size() * dim * dim);
+    for (const auto &op : ops)
+      for (const auto &element : op.data) {
+        key.push_back(element.real());
+        key.push_back(element.imag());
+      }
+    auto iter = superoperatorCache.find(key);
+    if (iter != superoperatorCache.end())
+      return iter->second;
+
+    // Note: Kraus channel flattened matrix data is **row-major**.
+    Superoperator superop = Superoperator::Zero(dim * dim, dim * dim);
+    for (const auto &op : ops)
+      addSuperoperatorTerm(superop, op.data.data(), op.data.data(), dim);
+    return superoperatorCache.emplace(std::move(key), std::move(superop))
+        .first->second;
+  }
+
+  /// @brief Apply `superop` in place, on `qubits` (the first being the most
+  /// significant in the superoperator's row and column indices).
+  void applySuperoperator(const Superoperator &superop,
+                          const std::vector<std::size_t> &qubits) {
+    // Seen as a vector, the column-major density matrix has the row index in
+    // the low bits and the column index in the high bits.
+    const std::size_t numQubits = numQubitsInState();
+    std::vector<std::size_t> targets;
+    targets.reserve(2 * qubits.size());
+    for (auto index : qubits)
+      targets.push_back(index + numQubits);
+    targets.insert(targets.end(), qubits.begin(), qubits.end());
+    nvqir::kernels::applyGate(state.data(), 2 * numQubits, superop.data(), {},
+                              targets);
+  }
+
+  /// @brief Apply the gate and, if the noise model attaches channels to it,
+  /// those channels as well in a single pass over the density matrix.
+  void applyGate(const GateApplicationTask &task) override {
+    gateNoiseApplied = false;
+    const std::size_t numGateQubits =
+        task.controls.size() + task.targets.size();
+    if (!executionContext || !executionContext->noiseModel ||
+        numGateQubits > maxFusedNoiseQubits)
+      return QppCircuitSimulator::applyGate(task);
+
+    std::vector<double> params(task.parameters.begin(),
+                               task.parameters.end());
+    auto krausChannels = executionContext->noiseModel->get_channels(
+        task.operationName, task.targets, task.controls, params);
+    if (krausChannels.empty())
+      return QppCircuitSimulator::applyGate(task);
+
+    // The gate as a matrix on (controls..., targets...), with the controls as
+    // the most significant bits, to match the qubit order of the channels.
+    const std::size_t dim = 1ULL << numGateQubits;
+    const std::size_t targetDim = 1ULL << task.targets.size();
+    const std::size_t controlledBlock = dim - targetDim;
+    std::vector<std::complex<double>> gate(dim * dim, 0.0);
+    for (std::size_t i = 0; i < controlledBlock; ++i)
+      gate[i * dim + i] = 1.0;
+    for (std::size_t r = 0; r < targetDim; ++r)
+      for (std::size_t c = 0; c < targetDim; ++c)
+        gate[(controlledBlock + r) * dim + controlledBlock + c] =
+            task.matrix[r * targetDim + c];
+
+    Superoperator fused = Superoperator::Zero(dim * dim, dim * dim);
+    addSuperoperatorTerm(fused, gate.data(), gate.data(), dim);
+    for (const auto &channel : krausChannels)
+      fused = getSuperoperator(channel, numGateQubits) * fused;
+
+    std::vector<std::size_t> qubits{task.controls.begin(),
+                                    task.controls.end()};
+    qubits.insert(qubits.end(), task.targets.begin(), task.targets.end());
+    CUDAQ_INFO("Applying {} with {} fused kraus channels to qubits {}",
+               task.operationName, krausChannels.size(), qubits);
+    applySuperoperator(fused, qubits);
+    gateNoiseApplied = true;
+  }
+
   /// @brief If we have a noise model, apply any user-specified
   /// kraus_channels for the given gate name on the provided qubits.
   /// @param gateName
@@ -141,6 +267,10 @@ protected:
                          const std::vector<std::size_t> &controls,
                          const std::vector<std::size_t> &targets,
                          const std::vector<double> &params) override {
+    // The channels were already fused into the gate.
+    if (std::exchange(gateNoiseApplied, false))
+      return;
+
     // Do nothing if no execution context
     if (!executionContext)
       return;
@@ -153,10 +283,6 @@ protected:
     std::string gName(gateName);
     std::vector<std::size_t> qubits{controls.begin(), controls.end()};
     qubits.insert(qubits.end(), targets.begin(), targets.end());
-    std::vector<std::size_t> casted_qubits;
-    for (auto index : qubits) {
-      casted_qubits.push_back(convertQubitIndex(index));
-    }
 
     // Get the Kraus channels specified for this gate and qubits
     auto krausChannels = executionContext->noiseModel->get_channels(
@@ -169,23 +295,8 @@ protected:
     CUDAQ_INFO("Applying {} kraus channels to qubits {}", krausChannels.size(),
                qubits);
 
-    for (auto &channel : krausChannels) {
-      // Map our kraus ops to the qpp::cmat
-      std::vector<qpp::cmat> K;
-      auto ops = channel.get_ops();
-      std::transform(ops.begin(), ops.end(), std::back_inserter(K),
-                     [&](auto &el) {
-                       // Note: Kraus channel flattened matrix data is
-                       // **row-major**.
-                       return Eigen::Map<
-                           Eigen::Matrix<std::complex<double>, Eigen::Dynamic,
-                                         Eigen::Dynamic, Eigen::RowMajor>>(
-                           el.data.data(), el.nRows, el.nCols);
-                     });
-
-      // Apply K rho Kdag
-      state = qpp::apply(state, K, casted_qubits);
-    }
+    for (auto &channel : krausChannels)
+      applySuperoperator(getSuperoperator(channel, qubits.size()), qubits);
   }
 
   /// @brief This simulator supports all noise channels
@@ -197,25 +308,11 @@ protected:
   void applyNoise(const cudaq::kraus_channel &channel,
                   const std::vector<std::size_t> &qubits) override {
     flushGateQueue();
+    stopPrefix();
     CUDAQ_INFO("[qpp-dm] apply kraus channel {}", channel.get_type_name());
-    std::vector<std::size_t> casted_qubits;
-    for (auto index : qubits) {
-      casted_qubits.push_back(convertQubitIndex(index));
-    }
-    // Map our kraus ops to the qpp::cmat
-    std::vector<qpp::cmat> K;
-    auto ops = channel.get_ops();
-    std::transform(
-        ops.begin(), ops.end(), std::back_inserter(K), [&](auto &el) {
-          // Note: Kraus channel flattened matrix data is
-          // **row-major**.
-          return Eigen::Map<Eigen::Matrix<std::complex<double>, Eigen::Dynamic,
-                                          Eigen::Dynamic, Eigen::RowMajor>>(
-              el.data.data(), el.nRows, el.nCols);
-        });
-
-    // Apply K rho Kdag
-    state = qpp::apply(state, K, casted_qubits);
+    applySuperoperator(getSuperoperator(channel, qubits.size()), qubits);
+    for (auto q : qubits)
+      setBasisState(q, std::nullopt);
   }
 
   /// @brief Grow the density matrix by one qubit.
@@ -229,8 +326,8 @@ protected:
     if (state.size() == 0) {
       // If this is the first time, allocate the state
       if (!stateDataIn) {
-        state = qpp::cmat::Zero(stateDimension, stateDimension);
-        state(0, 0) = 1.0;
+        allocateZeroState();
+        startPrefix();
       } else {
         // rho = |psi><psi|
         auto *stateData = reinterpret_cast<std::complex<double> *>(
@@ -244,16 +341,14 @@ protected:
 
     // We're adding qubits to an existing state.
     if (!stateDataIn) {
-      qpp::cmat zero_state = qpp::cmat::Zero(1 << qubitCount, 1 << qubitCount);
-      zero_state(0, 0) = 1.0;
-      state = qpp::kron(zero_state, state);
+      growStateInPlace(qubitCount, nullptr);
     } else {
       // rho = |psi><psi|
       auto *stateData = reinterpret_cast<std::complex<double> *>(
           const_cast<void *>(stateDataIn));
       qpp::ket psi = qpp::ket::Map(stateData, (1UL << qubitCount));
       qpp::cmat rho = psi * psi.adjoint();
-      state = qpp::kron(rho, state);
+      growStateInPlace(qubitCount, rho.data());
     }
   }
 
@@ -264,13 +359,10 @@ protected:
       throw std::invalid_argument(
           "[QppNoiseCircuitSimulator] Incompatible state input");
 
-    state =
-        (state.size() == 0) ? casted->state : qpp::kron(casted->state, state);
-  }
-
-  void setToZeroState() override {
-    state = qpp::cmat::Zero(stateDimension, stateDimension);
-    state(0, 0) = 1.0;
+    if (state.size() == 0)
+      state = casted->state;
+    else
+      growStateInPlace(casted->getNumQubits(), casted->state.data());
   }
 
 public:
@@ -280,6 +372,7 @@ public:
 
   std::unique_ptr<cudaq::SimulationState> getSimulationState() override {
     flushGateQueue();
+    stopPrefix();
     return std::make_unique<QppDmState>(std::move(state));
   }
 
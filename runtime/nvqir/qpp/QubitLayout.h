@@ -0,0 +1,128 @@
+/****************************************************************-*- C++ -*-****
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace nvqir {
+
+/// @brief Maps the logical qubits of a simulator to the physical bit
+/// positions of its amplitude index.
+///
+/// Simulators that split the amplitude index into a fast part (e.g., the
+/// amplitudes held by one MPI rank, or one cache-sized block) and a slow part
+/// move qubits between the two with bit swaps of the state, and track here
+/// where each qubit lives, instead of swapping them back after every gate.
+/// The positions also record when they were last used by a gate, so that
+/// the qubit moved out of the fast part is the least recently used one.
+class QubitLayout {
+  std::vector<std::size_t> physicalOf;
+  std::vector<std::size_t> logicalOf;
+  std::vector<std::uint64_t> lastUse;
+  std::uint64_t clock = 0;
+
+public:
+  std::size_t size() const { return physicalOf.size(); }
+
+  /// @brief Map logical qubit `q` to position `q` for `numQubits` qubits.
+  void reset(std::size_t numQubits) {
+    physicalOf.resize(numQubits);
+    std::iota(physicalOf.begin(), physicalOf.end(), 0);
+    logicalOf = physicalOf;
+    lastUse.assign(numQubits, 0);
+  }
+
+  bool isIdentity() const {
+    for (std::size_t q = 0; q < physicalOf.size(); ++q)
+      if (physicalOf[q] != q)
+        return false;
+    return true;
+  }
+
+  std::size_t physical(std::size_t logicalQubit) const {
+    return physicalOf[logicalQubit];
+  }
+
+  std::size_t logical(std::size_t position) const {
+    return logicalOf[position];
+  }
+
+  /// @brief Add `count` logical qubits, placed at the physical positions
+  /// `[position, position + count)`. The positions from `position` up are
+  /// shifted up by `count`.
+  void insert(std::size_t position, std::size_t count) {
+    for (auto &p : physicalOf)
+      if (p >= position)
+        p += count;
+    for (std::size_t k = 0; k < count; ++k)
+      physicalOf.push_back(position + k);
+    logicalOf.resize(physicalOf.size());
+    for (std::size_t q = 0; q < physicalOf.size(); ++q)
+      logicalOf[physicalOf[q]] = q;
+    lastUse.insert(lastUse.begin() + position, count, 0);
+  }
+
+  /// @brief Remove the last logical qubit. The positions above its own are
+  /// shifted down by one.
+  void removeLast() {
+    const std::size_t position = physicalOf.back();
+    physicalOf.pop_back();
+    for (auto &p : physicalOf)
+      if (p > position)
+        --p;
+    logicalOf.resize(physicalOf.size());
+    for (std::size_t q = 0; q < physicalOf.size(); ++q)
+      logicalOf[physicalOf[q]] = q;
+    lastUse.erase(lastUse.begin() + position);
+  }
+
+  /// @brief Record that the qubit at `position` was used by a gate.
+  void touch(std::size_t position) { lastUse[position] = ++clock; }
+
+  /// @brief Exchange the qubits at two physical positions. The state must be
+  /// updated with the matching bit swap.
+  void swapPositions(std::size_t a, std::size_t b) {
+    std::swap(logicalOf[a], logicalOf[b]);
+    std::swap(lastUse[a], lastUse[b]);
+    physicalOf[logicalOf[a]] = a;
+    physicalOf[logicalOf[b]] = b;
+  }
+
+  /// @brief The least recently used position in `[begin, end)` whose bit is
+  /// not set in `excluded`, or `end` if there is none.
+  std::size_t leastRecentlyUsed(std::size_t begin, std::size_t end,
+                                std::uint64_t excluded) const {
+    std::size_t best = end;
+    std::uint64_t bestUse = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t p = begin; p < end; ++p) {
+      if ((excluded >> p) & 1)
+        continue;
+      if (lastUse[p] < bestUse) {
+        best = p;
+        bestUse = lastUse[p];
+      }
+    }
+    return best;
+  }
+
+  /// @brief The physical amplitude index of the logical basis state `index`.
+  std::size_t physicalIndex(std::size_t index) const {
+    std::size_t result = 0;
+    for (std::size_t q = 0; q < physicalOf.size(); ++q)
+      result |= ((index >> q) & 1) << physicalOf[q];
+    return result;
+  }
+};
+
+} // namespace nvqir
@@ -0,0 +1,167 @@
+/****************************************************************-*- C++ -*-****
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+
+/// Deterministic parallel sums over the amplitudes of a state.
+///
+/// The index range is split into chunks whose number only depends on its
+/// length, never on the number of OpenMP threads, and the chunk results are
+/// folded in order, so a reduction gives the same bits for any thread count.
+/// Within a chunk, `reductionLanes` interleaved accumulators are kept so that
+/// the loop vectorizes, and all accumulators use compensated (Neumaier)
+/// summation, whose error does not grow with the state dimension.
+namespace nvqir::kernels {
+
+/// @brief Minimum number of terms per chunk of a reduction.
+inline constexpr std::size_t minReductionChunkSize = 1ULL << 12;
+
+/// @brief Maximum number of partial sums kept per value when reducing over
+/// the state in parallel.
+inline constexpr std::size_t maxReductionChunks = 64;
+
+/// @brief Number of interleaved accumulators per chunk, one per SIMD lane of
+/// an AVX2 register of doubles.
+inline constexpr std::size_t reductionLanes = 4;
+
+/// @brief Add `x` to the running sum `sum`, keeping the rounding error of
+/// every addition in `compensation`.
+inline void compensatedAdd(double &sum, double &compensation, double x) {
+  const double t = sum + x;
+  compensation +=
+      std::abs(sum) >= std::abs(x) ? (sum - t) + x : (x - t) + sum;
+  sum = t;
+}
+
+/// @brief A compensated sum of doubles.
+struct CompensatedSum {
+  double sum = 0.0;
+  double compensation = 0.0;
+
+  void add(double x) { compensatedAdd(sum, compensation, x); }
+
+  void add(const CompensatedSum &other) {
+    add(other.sum);
+    compensation += other.compensation;
+  }
+
+  double value() const { return sum + compensation; }
+};
+
+/// @brief Number of chunks a reduction over `size` terms is split into.
+inline std::size_t numReductionChunks(std::size_t size) {
+  return std::clamp<std::size_t>(size / minReductionChunkSize, 1,
+                                 maxReductionChunks);
+}
+
+/// @brief The sums over `i` in `[0, size)` of the `NumSums` values returned
+/// by `terms(i)` as a `std::array<double, NumSums>`.
+template <std::size_t NumSums, typename TermsFn>
+std::array<double, NumSums> reduceSums(std::size_t size, TermsFn &&terms) {
+  const std::size_t numChunks = numReductionChunks(size);
+  std::array<std::array<CompensatedSum, NumSums>, maxReductionChunks> partial;
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numChunks > 1)
+#endif
+  for (std::size_t c = 0; c < numChunks; ++c) {
+    const std::size_t begin = size * c / numChunks;
+    const std::size_t end = size * (c + 1) / numChunks;
+    double sums[NumSums][reductionLanes] = {};
+    double compensations[NumSums][reductionLanes] = {};
+    std::size_t i = begin;
+    for (; i + reductionLanes <= end; i += reductionLanes) {
+      double values[NumSums][reductionLanes];
+      for (std::size_t l = 0; l < reductionLanes; ++l) {
+        const std::array<double, NumSums> laneValues = terms(i + l);
+        for (std::size_t s = 0; s < NumSums; ++s)
+          values[s][l] = laneValues[s];
+      }
+      for (std::size_t s = 0; s < NumSums; ++s)
+#if defined(_OPENMP)
+#pragma omp simd
+#endif
+        for (std::size_t l = 0; l < reductionLanes; ++l)
+          compensatedAdd(sums[s][l], compensations[s][l], values[s][l]);
+    }
+    for (; i < end; ++i) {
+      const std::array<double, NumSums> values = terms(i);
+      for (std::size_t s = 0; s < NumSums; ++s)
+        compensatedAdd(sums[s][0], compensations[s][0], values[s]);
+    }
+    for (std::size_t s = 0; s < NumSums; ++s) {
+      partial[c][s] = CompensatedSum{};
+      for (std::size_t l = 0; l < reductionLanes; ++l)
+        partial[c][s].add(CompensatedSum{sums[s][l], compensations[s][l]});
+    }
+  }
+
+  std::array<double, NumSums> results;
+  for (std::size_t s = 0; s < NumSums; ++s) {
+    CompensatedSum total;
+    for (std::size_t c = 0; c < numChunks; ++c)
+      total.add(partial[c][s]);
+    results[s] = total.value();
+  }
+  return results;
+}
+
+/// @brief The sum over `i` in `[0, size)` of `term(i)`.
+template <typename TermFn>
+double reduceSum(std::size_t size, TermFn &&term) {
+  return reduceSums<1>(size, [&term](std::size_t i) {
+    return std::array<double, 1>{term(i)};
+  })[0];
+}
+
+/// @brief The sum over `i` in `[0, size)` of the complex `term(i)`.
+template <typename TermFn>
+std::complex<double> reduceComplexSum(std::size_t size, TermFn &&term) {
+  const auto sums = reduceSums<2>(size, [&term](std::size_t i) {
+    const std::complex<double> value = term(i);
+    return std::array<double, 2>{value.real(), value.imag()};
+  });
+  return {sums[0], sums[1]};
+}
+
+/// @brief The inner product `<a|b>` of the `size` amplitudes in `a` and `b`.
+template <typename ScalarType>
+std::complex<double> innerProduct(const std::complex<ScalarType> *a,
+                                  const std::complex<ScalarType> *b,
+                                  std::size_t size) {
+  return reduceComplexSum(size, [a, b](std::size_t i) {
+    const double ar = a[i].real(), ai = a[i].imag();
+    const double br = b[i].real(), bi = b[i].imag();
+    return std::complex<double>(ar * br + ai * bi, ar * bi - ai * br);
+  });
+}
+
+/// @brief `tr(rho * sigma)` for the `dim x dim` column-major matrices `rho`
+/// and `sigma`, without forming the product.
+template <typename ScalarType>
+std::complex<double> traceOfProduct(const std::complex<ScalarType> *rho,
+                                    const std::complex<ScalarType> *sigma,
+                                    std::size_t dim) {
+  return reduceComplexSum(dim * dim, [=](std::size_t k) {
+    // rho(i, j) sigma(j, i), with k = i + j * dim.
+    const std::size_t i = k % dim;
+    const std::size_t j = k / dim;
+    const double ar = rho[k].real(), ai = rho[k].imag();
+    const double br = sigma[j + i * dim].real();
+    const double bi = sigma[j + i * dim].imag();
+    return std::complex<double>(ar * br - ai * bi, ar * bi + ai * br);
+  });
+}
+
+} // namespace nvqir::kernels
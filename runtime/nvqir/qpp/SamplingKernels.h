@@ -0,0 +1,210 @@
+/****************************************************************-*- C++ -*-****
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Shot sampling over a probability distribution given as a function of the
+/// amplitude index (e.g., `|psi_i|^2` or `rho_ii`).
+///
+/// Outcomes are returned as packed integer keys: bit `b` of a key is the
+/// measured value of `qubits[b]`. Only random numbers are drawn serially from
+/// the caller's generator, so a seeded run gives the same counts regardless of
+/// the number of OpenMP threads.
+namespace nvqir::kernels {
+
+/// @brief Number of measured qubits up to which we reduce the distribution to
+/// its marginal table before sampling.
+inline constexpr std::size_t maxMarginalQubits = 10;
+
+/// @brief Maximum number of partial marginal tables accumulated in parallel.
+inline constexpr std::size_t maxMarginalChunks = 256;
+
+/// @brief Number of amplitudes summed serially per chunk when sampling over
+/// the full index space. Fixed so that the partial sums do not depend on the
+/// thread count.
+inline constexpr std::size_t samplingChunkSize = 1ULL << 14;
+
+/// @brief Gather the bits of `index` at `qubits` into a packed outcome key.
+inline std::uint64_t outcomeKey(std::size_t index,
+                                const std::vector<std::size_t> &qubits) {
+  std::uint64_t key = 0;
+  for (std::size_t b = 0; b < qubits.size(); ++b)
+    key |= static_cast<std::uint64_t>((index >> qubits[b]) & 1) << b;
+  return key;
+}
+
+/// @brief Draw `shots` uniforms in `[0, total)` and sort them.
+template <typename Generator>
+std::vector<double> sortedUniforms(std::size_t shots, double total,
+                                   Generator &gen) {
+  std::uniform_real_distribution<double> dist(0.0, total);
+  std::vector<double> uniforms(shots);
+  for (auto &u : uniforms)
+    u = dist(gen);
+  std::sort(uniforms.begin(), uniforms.end());
+  return uniforms;
+}
+
+/// @brief Sample `shots` outcomes from the (unnormalized) marginal table
+/// `marginal`. With at least as many shots as outcomes, the counts are drawn
+/// directly from the multinomial distribution as a chain of binomials, so the
+/// cost does not grow with the number of shots.
+template <typename Generator>
+std::vector<std::pair<std::uint64_t, std::size_t>>
+sampleMarginal(const std::vector<double> &marginal, std::size_t shots,
+               Generator &gen) {
+  std::vector<std::pair<std::uint64_t, std::size_t>> counts;
+  double remainingProb = 0.0;
+  std::size_t last = 0;
+  for (std::size_t k = 0; k < marginal.size(); ++k) {
+    remainingProb += marginal[k];
+    if (marginal[k] > 0.0)
+      last = k;
+  }
+
+  if (shots >= marginal.size()) {
+    std::size_t remainingShots = shots;
+    for (std::size_t k = 0; k < marginal.size() && remainingShots > 0; ++k) {
+      if (marginal[k] <= 0.0)
+        continue;
+      std::size_t count = remainingShots;
+      if (k != last && remainingProb > 0.0) {
+        const double p = std::min(1.0, marginal[k] / remainingProb);
+        count =
+            std::binomial_distribution<std::size_t>(remainingShots, p)(gen);
+      }
+      remainingProb -= marginal[k];
+      remainingShots -= count;
+      if (count > 0)
+        counts.emplace_back(k, count);
+    }
+    return counts;
+  }
+
+  const auto uniforms = sortedUniforms(shots, remainingProb, gen);
+  double cumulative = 0.0;
+  std::size_t k = 0;
+  for (const double u : uniforms) {
+    while (k < last && cumulative + marginal[k] <= u)
+      cumulative += marginal[k++];
+    if (!counts.empty() && counts.back().first == k)
+      ++counts.back().second;
+    else
+      counts.emplace_back(k, 1);
+  }
+  return counts;
+}
+
+/// @brief Sample `shots` measurements of `qubits` from the `2^numQubits`
+/// probabilities given by `probability(index)`, which need not be exactly
+/// normalized. Returns the distinct outcome keys with their counts.
+///
+/// For a few measured qubits the marginal distribution is accumulated in a
+/// single pass over the state. Otherwise, chunk sums are computed in parallel
+/// and each chunk maps the sorted uniforms falling in its range onto
+/// amplitude indices in a second parallel pass.
+template <typename ProbabilityFn, typename Generator>
+std::vector<std::pair<std::uint64_t, std::size_t>>
+sampleOutcomes(ProbabilityFn &&probability, std::size_t numQubits,
+               const std::vector<std::size_t> &qubits, std::size_t shots,
+               Generator &gen) {
+  const std::size_t dim = 1ULL << numQubits;
+  bool identityKey = qubits.size() == numQubits;
+  for (std::size_t b = 0; identityKey && b < qubits.size(); ++b)
+    identityKey = qubits[b] == b;
+  const auto keyOf = [&](std::size_t index) -> std::uint64_t {
+    return identityKey ? index : outcomeKey(index, qubits);
+  };
+
+  if (qubits.size() <= maxMarginalQubits) {
+    const std::size_t numOutcomes = 1ULL << qubits.size();
+    const std::size_t chunkSize =
+        std::max(samplingChunkSize, dim / maxMarginalChunks);
+    const std::size_t numChunks = (dim + chunkSize - 1) / chunkSize;
+    std::vector<double> partial(numChunks * numOutcomes, 0.0);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+    for (std::size_t c = 0; c < numChunks; ++c) {
+      double *table = partial.data() + c * numOutcomes;
+      const std::size_t end = std::min(dim, (c + 1) * chunkSize);
+      for (std::size_t i = c * chunkSize; i < end; ++i)
+        table[keyOf(i)] += probability(i);
+    }
+    std::vector<double> marginal(numOutcomes, 0.0);
+    for (std::size_t c = 0; c < numChunks; ++c)
+      for (std::size_t k = 0; k < numOutcomes; ++k)
+        marginal[k] += partial[c * numOutcomes + k];
+    return sampleMarginal(marginal, shots, gen);
+  }
+
+  // Pass 1: the probability mass of each chunk.
+  const std::size_t numChunks = (dim + samplingChunkSize - 1) /
+                                samplingChunkSize;
+  std::vector<double> chunkStart(numChunks + 1, 0.0);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+  for (std::size_t c = 0; c < numChunks; ++c) {
+    double sum = 0.0;
+    const std::size_t end = std::min(dim, (c + 1) * samplingChunkSize);
+    for (std::size_t i = c * samplingChunkSize; i < end; ++i)
+      sum += probability(i);
+    chunkStart[c + 1] = sum;
+  }
+  for (std::size_t c = 0; c < numChunks; ++c)
+    chunkStart[c + 1] += chunkStart[c];
+
+  const auto uniforms = sortedUniforms(shots, chunkStart.back(), gen);
+
+  // Pass 2: walk each chunk's cumulative sum over the uniforms in its range,
+  // recording runs of equal amplitude indices.
+  std::vector<std::vector<std::pair<std::size_t, std::size_t>>> runs(
+      numChunks);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (std::size_t c = 0; c < numChunks; ++c) {
+    auto first = std::lower_bound(uniforms.begin(), uniforms.end(),
+                                  chunkStart[c]);
+    // Rounding in the last chunk must not drop any draws.
+    auto last = c + 1 == numChunks
+                    ? uniforms.end()
+                    : std::lower_bound(first, uniforms.end(),
+                                       chunkStart[c + 1]);
+    if (first == last)
+      continue;
+    const std::size_t end = std::min(dim, (c + 1) * samplingChunkSize);
+    std::size_t i = c * samplingChunkSize;
+    double cumulative = chunkStart[c] + probability(i);
+    for (auto it = first; it != last; ++it) {
+      while (i + 1 < end && cumulative <= *it)
+        cumulative += probability(++i);
+      if (!runs[c].empty() && runs[c].back().first == i)
+        ++runs[c].back().second;
+      else
+        runs[c].emplace_back(i, 1);
+    }
+  }
+
+  std::unordered_map<std::uint64_t, std::size_t> keyCounts;
+  for (const auto &chunkRuns : runs)
+    for (const auto &[index, count] : chunkRuns)
+      keyCounts[keyOf(index)] += count;
+  return {keyCounts.begin(), keyCounts.end()};
+}
+
+} // namespace nvqir::kernels
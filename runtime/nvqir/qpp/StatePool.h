@@ -0,0 +1,177 @@
+/****************************************************************-*- C++ -*-****
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#pragma once
+
+#include "StateVectorKernels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace nvqir {
+
+/// @brief Ask the kernel to back the pages of `[data, data + bytes)` with
+/// transparent huge pages. Must be called before the pages are first touched
+/// to have an effect. This is a no-op on platforms without `MADV_HUGEPAGE`.
+inline void adviseHugePages(void *data, std::size_t bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+  const auto begin = (reinterpret_cast<std::uintptr_t>(data) + pageSize - 1) &
+                     ~(pageSize - 1);
+  const auto end =
+      (reinterpret_cast<std::uintptr_t>(data) + bytes) & ~(pageSize - 1);
+  // Failure (e.g., THP disabled system-wide) just leaves regular pages.
+  if (end > begin)
+    madvise(reinterpret_cast<void *>(begin), end - begin, MADV_HUGEPAGE);
+#else
+  (void)data;
+  (void)bytes;
+#endif
+}
+
+/// @brief A pool of released state buffers, keyed by their number of
+/// elements, so that repeatedly simulating kernels of the same size does not
+/// return the memory to the system and fault it back in on every execution.
+///
+/// Buffers are Eigen matrices (`StateType` is a `qpp::ket`-like vector or a
+/// `qpp::cmat`-like matrix) and keep Eigen's allocation alignment. Fresh
+/// buffers are cleared in parallel, which places their pages on the NUMA
+/// nodes of the threads that later apply gates to them.
+template <typename StateType>
+class StatePool {
+  using Scalar = typename StateType::Scalar;
+
+  /// @brief Released buffers, oldest first.
+  std::vector<StateType> buffers;
+
+  /// @brief Upper bound on the total size of the pooled buffers.
+  std::size_t maxBytes = 0;
+
+  /// @brief Size the capacity from the largest buffer seen instead of a
+  /// fixed budget.
+  bool autoCapacity = false;
+
+  /// @brief Upper bound on an automatic capacity.
+  std::size_t maxAutoBytes = std::numeric_limits<std::size_t>::max();
+
+  /// @brief Request transparent huge pages for freshly allocated buffers.
+  bool useHugePages = false;
+
+  static std::size_t bytesOf(const StateType &buffer) {
+    return static_cast<std::size_t>(buffer.size()) * sizeof(Scalar);
+  }
+
+  /// @brief Grow an automatic capacity to hold two buffers of `bytes`, the
+  /// state and a saved copy of it, up to `maxAutoBytes`.
+  void growCapacity(std::size_t bytes) {
+    if (autoCapacity)
+      maxBytes = std::min(std::max(maxBytes, 2 * bytes), maxAutoBytes);
+  }
+
+public:
+  /// @brief Minimum capacity of an automatically sized pool.
+  static constexpr std::size_t minAutoCapacityBytes = std::size_t(1) << 30;
+
+  /// @brief Default upper bound on an automatic capacity: a quarter of the
+  /// physical memory, or no bound if it is unknown.
+  static std::size_t defaultMaxAutoCapacityBytes() {
+#if defined(__linux__)
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0)
+      return static_cast<std::size_t>(pages) *
+             static_cast<std::size_t>(pageSize) / 4;
+#endif
+    return std::numeric_limits<std::size_t>::max();
+  }
+
+  /// @brief Set the pool capacity in bytes (0 disables pooling) and whether
+  /// new buffers are allocated on transparent huge pages. Without a
+  /// capacity, it is the larger of `minAutoCapacityBytes` and two buffers of
+  /// the largest size acquired so far, so that the state of any kernel run
+  /// so far can be reused, but never more than `maxAutoCapacity`. Larger
+  /// buffers are freed on release rather than kept.
+  void configure(std::optional<std::size_t> capacityBytes, bool hugePages,
+                 std::size_t maxAutoCapacity = defaultMaxAutoCapacityBytes()) {
+    autoCapacity = !capacityBytes.has_value();
+    maxAutoBytes = maxAutoCapacity;
+    maxBytes = capacityBytes.value_or(
+        std::min(minAutoCapacityBytes, maxAutoCapacity));
+    useHugePages = hugePages;
+    trim(0);
+  }
+
+  /// @brief Return a zero-filled `rows x cols` buffer, reusing a pooled
+  /// buffer with the same number of elements if there is one.
+  StateType acquire(std::size_t rows, std::size_t cols) {
+    const std::size_t size = rows * cols;
+    growCapacity(size * sizeof(Scalar));
+    for (auto it = buffers.rbegin(); it != buffers.rend(); ++it) {
+      if (static_cast<std::size_t>(it->size()) != size)
+        continue;
+      StateType buffer = std::move(*it);
+      buffers.erase(std::next(it).base());
+      // Same total size, so this only updates the dimensions.
+      buffer.resize(rows, cols);
+      kernels::clearState(buffer.data(), size);
+      return buffer;
+    }
+
+    StateType buffer(rows, cols);
+    if (useHugePages)
+      adviseHugePages(buffer.data(), bytesOf(buffer));
+    kernels::clearState(buffer.data(), size);
+    return buffer;
+  }
+
+  /// @brief Return `buffer` to the pool, evicting the oldest buffers if the
+  /// capacity would be exceeded. Buffers larger than the capacity are freed.
+  void release(StateType &&buffer) {
+    const std::size_t bytes = bytesOf(buffer);
+    if (bytes == 0 || bytes > maxBytes) {
+      buffer = StateType();
+      return;
+    }
+    trim(bytes);
+    buffers.push_back(std::move(buffer));
+  }
+
+  /// @brief Upper bound on the total size of the pooled buffers in bytes.
+  std::size_t capacityBytes() const { return maxBytes; }
+
+  /// @brief Total size of the pooled buffers in bytes.
+  std::size_t pooledBytes() const {
+    std::size_t total = 0;
+    for (const auto &buffer : buffers)
+      total += bytesOf(buffer);
+    return total;
+  }
+
+private:
+  /// @brief Evict the oldest buffers until `extraBytes` more fit.
+  void trim(std::size_t extraBytes) {
+    std::size_t total = pooledBytes();
+    std::size_t evict = 0;
+    while (evict < buffers.size() && total + extraBytes > maxBytes)
+      total -= bytesOf(buffers[evict++]);
+    buffers.erase(buffers.begin(), buffers.begin() + evict);
+  }
+};
+
+} // namespace nvqir
@@ -0,0 +1,774 @@
+/****************************************************************-*- C++ -*-****
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#pragma once
+
+#include "ReductionKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/// In-place gate kernels operating directly on a state vector buffer.
+///
+/// All kernels in this file use the CUDA-Q (little endian) qubit convention:
+/// qubit `q` corresponds to bit `q` of the amplitude index. For a gate matrix
+/// acting on `targets`, `targets[0]` is the most significant bit of the
+/// matrix row/column index (the same ordering Q++ uses for `qpp::apply`).
+namespace nvqir::kernels {
+
+/// @brief Minimum number of inner iterations before a kernel is worth
+/// splitting across OpenMP threads.
+inline constexpr std::size_t minParallelWork = 1ULL << 12;
+
+/// @brief Complex multiplication written out on the real and imaginary parts.
+/// Unlike `std::complex::operator*`, this never calls into the (slow) C99
+/// Annex G runtime helpers that handle infinities and NaNs.
+template <typename ScalarType>
+inline std::complex<ScalarType> cmul(const std::complex<ScalarType> &a,
+                                     const std::complex<ScalarType> &b) {
+  return {a.real() * b.real() - a.imag() * b.imag(),
+          a.real() * b.imag() + a.imag() * b.real()};
+}
+
+/// @brief Insert a zero bit into `idx` at each of the bit positions in
+/// `insertMasks`. The masks are `(1 << position) - 1` for the positions sorted
+/// in ascending order.
+inline std::size_t insertZeroBits(std::size_t idx,
+                                  const std::size_t *insertMasks,
+                                  std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::size_t low = idx & insertMasks[i];
+    idx = ((idx ^ low) << 1) | low;
+  }
+  return idx;
+}
+
+/// @brief Precomputed indexing data shared by all the gate kernels: the masks
+/// used to expand a loop counter into the base amplitude index of a group, and
+/// the control bits to set in that base index.
+struct GateIndexing {
+  /// Insertion masks for all the target and control positions, ascending.
+  std::vector<std::size_t> insertMasks;
+  /// Bit mask of all the control qubits.
+  std::size_t controlMask = 0;
+  /// Number of amplitude groups the gate acts on.
+  std::size_t numGroups = 0;
+  /// Lowest bit position touched by the gate.
+  std::size_t lowestPosition = 0;
+
+  GateIndexing(std::size_t numQubits, const std::vector<std::size_t> &controls,
+               const std::vector<std::size_t> &targets) {
+    std::vector<std::size_t> positions(targets.begin(), targets.end());
+    positions.insert(positions.end(), controls.begin(), controls.end());
+    std::sort(positions.begin(), positions.end());
+    assert(std::adjacent_find(positions.begin(), positions.end()) ==
+               positions.end() &&
+           "Duplicate qubit in gate application");
+    assert(!positions.empty() && positions.back() < numQubits &&
+           "Qubit index out of range");
+    insertMasks.reserve(positions.size());
+    for (auto p : positions)
+      insertMasks.push_back((1ULL << p) - 1);
+    for (auto c : controls)
+      controlMask |= (1ULL << c);
+    numGroups = 1ULL << (numQubits - positions.size());
+    lowestPosition = positions.front();
+  }
+
+  /// @brief Return the base amplitude index (all targets zero, all controls
+  /// one) of the `i`-th group.
+  std::size_t base(std::size_t i) const {
+    return insertZeroBits(i, insertMasks.data(), insertMasks.size()) |
+           controlMask;
+  }
+};
+
+/// @brief Compute the offsets of the amplitudes of one group relative to the
+/// group base index, in matrix index order.
+template <std::size_t Dim>
+std::array<std::size_t, Dim>
+computeOffsets(const std::vector<std::size_t> &targets) {
+  std::array<std::size_t, Dim> offsets{};
+  const std::size_t nTargets = targets.size();
+  for (std::size_t m = 0; m < Dim; ++m)
+    for (std::size_t j = 0; j < nTargets; ++j)
+      if ((m >> (nTargets - 1 - j)) & 1)
+        offsets[m] |= (1ULL << targets[j]);
+  return offsets;
+}
+
+/// @brief Vectorized complex arithmetic. Each register holds `width`
+/// interleaved complex numbers. The primary template has no SIMD support and
+/// makes the kernels use their scalar path.
+template <typename ScalarType>
+struct SimdComplex {
+  static constexpr std::size_t width = 1;
+};
+
+#if defined(__AVX512F__)
+template <>
+struct SimdComplex<double> {
+  using reg = __m512d;
+  static constexpr std::size_t width = 4;
+  static reg load(const std::complex<double> *p) {
+    return _mm512_loadu_pd(reinterpret_cast<const double *>(p));
+  }
+  static void store(std::complex<double> *p, reg v) {
+    _mm512_storeu_pd(reinterpret_cast<double *>(p), v);
+  }
+  static reg broadcast(double v) { return _mm512_set1_pd(v); }
+  static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+  /// Multiply `v` by the complex scalar `(re, im)` given as broadcasts.
+  static reg mul(reg v, reg re, reg im) {
+    return _mm512_fmaddsub_pd(v, re,
+                              _mm512_mul_pd(_mm512_permute_pd(v, 0x55), im));
+  }
+};
+
+template <>
+struct SimdComplex<float> {
+  using reg = __m512;
+  static constexpr std::size_t width = 8;
+  static reg load(const std::complex<float> *p) {
+    return _mm512_loadu_ps(reinterpret_cast<const float *>(p));
+  }
+  static void store(std::complex<float> *p, reg v) {
+    _mm512_storeu_ps(reinterpret_cast<float *>(p), v);
+  }
+  static reg broadcast(float v) { return _mm512_set1_ps(v); }
+  static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+  static reg mul(reg v, reg re, reg im) {
+    return _mm512_fmaddsub_ps(v, re,
+                              _mm512_mul_ps(_mm512_permute_ps(v, 0xB1), im));
+  }
+};
+#elif defined(__AVX2__) && defined(__FMA__)
+template <>
+struct SimdComplex<double> {
+  using reg = __m256d;
+  static constexpr std::size_t width = 2;
+  static reg load(const std::complex<double> *p) {
+    return _mm256_loadu_pd(reinterpret_cast<const double *>(p));
+  }
+  static void store(std::complex<double> *p, reg v) {
+    _mm256_storeu_pd(reinterpret_cast<double *>(p), v);
+  }
+  static reg broadcast(double v) { return _mm256_set1_pd(v); }
+  static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+  /// Multiply `v` by the complex scalar `(re, im)` given as broadcasts.
+  static reg mul(reg v, reg re, reg im) {
+    return _mm256_fmaddsub_pd(v, re,
+                              _mm256_mul_pd(_mm256_permute_pd(v, 0x5), im));
+  }
+};
+
+template <>
+struct SimdComplex<float> {
+  using reg = __m256;
+  static constexpr std::size_t width = 4;
+  static reg load(const std::complex<float> *p) {
+    return _mm256_loadu_ps(reinterpret_cast<const float *>(p));
+  }
+  static void store(std::complex<float> *p, reg v) {
+    _mm256_storeu_ps(reinterpret_cast<float *>(p), v);
+  }
+  static reg broadcast(float v) { return _mm256_set1_ps(v); }
+  static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg mul(reg v, reg re, reg im) {
+    return _mm256_fmaddsub_ps(v, re,
+                              _mm256_mul_ps(_mm256_permute_ps(v, 0xB1), im));
+  }
+};
+#endif
+
+/// @brief Apply a dense, row-major `2^NumTargets x 2^NumTargets` matrix to
+/// `targets`, conditioned on all `controls` being |1>, in place.
+///
+/// The number of targets is a compile time constant so that the per-group
+/// gather/multiply/scatter is fully unrolled. When the lowest qubit touched by
+/// the gate is above the SIMD width, consecutive groups have consecutive
+/// amplitudes and are processed a full register at a time.
+template <std::size_t NumTargets, typename ScalarType>
+void applyGateKernel(std::complex<ScalarType> *state, std::size_t numQubits,
+                     const std::complex<ScalarType> *matrix,
+                     const std::vector<std::size_t> &controls,
+                     const std::vector<std::size_t> &targets) {
+  constexpr std::size_t Dim = 1ULL << NumTargets;
+  assert(targets.size() == NumTargets);
+  const GateIndexing indexing(numQubits, controls, targets);
+  const auto offsets = computeOffsets<Dim>(targets);
+  std::array<std::complex<ScalarType>, Dim * Dim> mat;
+  std::copy(matrix, matrix + Dim * Dim, mat.begin());
+  const std::size_t numGroups = indexing.numGroups;
+
+  using Simd = SimdComplex<ScalarType>;
+  if constexpr (Simd::width > 1) {
+    if ((1ULL << indexing.lowestPosition) >= Simd::width) {
+      typename Simd::reg re[Dim * Dim], im[Dim * Dim];
+      for (std::size_t k = 0; k < Dim * Dim; ++k) {
+        re[k] = Simd::broadcast(mat[k].real());
+        im[k] = Simd::broadcast(mat[k].imag());
+      }
+      const std::size_t numBlocks = numGroups / Simd::width;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numBlocks >= minParallelWork)
+#endif
+      for (std::size_t b = 0; b < numBlocks; ++b) {
+        const std::size_t base = indexing.base(b * Simd::width);
+        typename Simd::reg in[Dim];
+        for (std::size_t c = 0; c < Dim; ++c)
+          in[c] = Simd::load(state + base + offsets[c]);
+        for (std::size_t r = 0; r < Dim; ++r) {
+          auto acc = Simd::mul(in[0], re[r * Dim], im[r * Dim]);
+          for (std::size_t c = 1; c < Dim; ++c)
+            acc = Simd::add(acc,
+                            Simd::mul(in[c], re[r * Dim + c], im[r * Dim + c]));
+          Simd::store(state + base + offsets[r], acc);
+        }
+      }
+      return;
+    }
+  }
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numGroups >= minParallelWork)
+#endif
+  for (std::size_t i = 0; i < numGroups; ++i) {
+    const std::size_t base = indexing.base(i);
+    std::array<std::complex<ScalarType>, Dim> in;
+    for (std::size_t c = 0; c < Dim; ++c)
+      in[c] = state[base + offsets[c]];
+    for (std::size_t r = 0; r < Dim; ++r) {
+      std::complex<ScalarType> acc = cmul(mat[r * Dim], in[0]);
+      for (std::size_t c = 1; c < Dim; ++c)
+        acc += cmul(mat[r * Dim + c], in[c]);
+      state[base + offsets[r]] = acc;
+    }
+  }
+}
+
+/// @brief Fallback for gates with more targets than we specialize for. Same
+/// algorithm as `applyGateKernel`, with per-thread scratch buffers.
+template <typename ScalarType>
+void applyGateKernelGeneric(std::complex<ScalarType> *state,
+                            std::size_t numQubits,
+                            const std::complex<ScalarType> *matrix,
+                            const std::vector<std::size_t> &controls,
+                            const std::vector<std::size_t> &targets) {
+  const std::size_t nTargets = targets.size();
+  const std::size_t dim = 1ULL << nTargets;
+  const GateIndexing indexing(numQubits, controls, targets);
+  std::vector<std::size_t> offsets(dim, 0);
+  for (std::size_t m = 0; m < dim; ++m)
+    for (std::size_t j = 0; j < nTargets; ++j)
+      if ((m >> (nTargets - 1 - j)) & 1)
+        offsets[m] |= (1ULL << targets[j]);
+  const std::size_t numGroups = indexing.numGroups;
+
+#if defined(_OPENMP)
+#pragma omp parallel if (numGroups >= minParallelWork)
+#endif
+  {
+    std::vector<std::complex<ScalarType>> in(dim);
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+    for (std::size_t i = 0; i < numGroups; ++i) {
+      const std::size_t base = indexing.base(i);
+      for (std::size_t c = 0; c < dim; ++c)
+        in[c] = state[base + offsets[c]];
+      for (std::size_t r = 0; r < dim; ++r) {
+        const std::complex<ScalarType> *row = matrix + r * dim;
+        std::complex<ScalarType> acc = cmul(row[0], in[0]);
+        for (std::size_t c = 1; c < dim; ++c)
+          acc += cmul(row[c], in[c]);
+        state[base + offsets[r]] = acc;
+      }
+    }
+  }
+}
+
+/// @brief Sparse form of a gate matrix with exactly one nonzero entry per row
+/// and column, i.e., a permutation matrix up to phases. Row `r` of the gate
+/// takes the amplitude at `columns[r]` scaled by `phases[r]`.
+template <typename ScalarType>
+struct MonomialGate {
+  std::vector<std::size_t> columns;
+  std::vector<std::complex<ScalarType>> phases;
+  /// True if the gate is diagonal (`columns[r] == r` for all rows).
+  bool diagonal = true;
+  /// True if all the nonzero entries are exactly 1, i.e., the gate only
+  /// moves amplitudes around.
+  bool unitPhases = true;
+};
+
+/// @brief Return the monomial form of the `dim x dim` (row-major) `matrix`,
+/// or `std::nullopt` for a general gate. Entries are compared against exact
+/// zero, which is what the gate definitions produce for diagonal and
+/// permutation gates.
+template <typename ScalarType>
+std::optional<MonomialGate<ScalarType>>
+toMonomialGate(const std::complex<ScalarType> *matrix, std::size_t dim) {
+  MonomialGate<ScalarType> gate;
+  gate.columns.resize(dim);
+  gate.phases.resize(dim);
+  std::vector<bool> columnUsed(dim, false);
+  for (std::size_t r = 0; r < dim; ++r) {
+    std::size_t numNonZeros = 0;
+    for (std::size_t c = 0; c < dim; ++c) {
+      if (matrix[r * dim + c] == std::complex<ScalarType>(0))
+        continue;
+      if (++numNonZeros > 1 || columnUsed[c])
+        return std::nullopt;
+      columnUsed[c] = true;
+      gate.columns[r] = c;
+      gate.phases[r] = matrix[r * dim + c];
+    }
+    if (numNonZeros == 0)
+      return std::nullopt;
+    gate.diagonal &= gate.columns[r] == r;
+    gate.unitPhases &= gate.phases[r] == std::complex<ScalarType>(1);
+  }
+  return gate;
+}
+
+/// @brief Apply a diagonal or permutation-like gate. Only the rows that the
+/// gate actually changes are touched: a diagonal gate is a single phase
+/// multiply per changed amplitude, and a pure permutation only moves
+/// amplitudes without any floating-point arithmetic.
+template <typename ScalarType>
+void applyMonomialGate(std::complex<ScalarType> *state, std::size_t numQubits,
+                       const MonomialGate<ScalarType> &gate,
+                       const std::vector<std::size_t> &controls,
+                       const std::vector<std::size_t> &targets) {
+  const std::size_t nTargets = targets.size();
+  const std::size_t dim = 1ULL << nTargets;
+  std::vector<std::size_t> offsets(dim, 0);
+  for (std::size_t m = 0; m < dim; ++m)
+    for (std::size_t j = 0; j < nTargets; ++j)
+      if ((m >> (nTargets - 1 - j)) & 1)
+        offsets[m] |= (1ULL << targets[j]);
+
+  // Rows that keep their own amplitude unscaled are never read by another
+  // row, so they can be skipped entirely.
+  std::vector<std::size_t> rows;
+  for (std::size_t r = 0; r < dim; ++r)
+    if (gate.columns[r] != r || gate.phases[r] != std::complex<ScalarType>(1))
+      rows.push_back(r);
+  if (rows.empty())
+    return;
+
+  const GateIndexing indexing(numQubits, controls, targets);
+  const std::size_t numGroups = indexing.numGroups;
+  if (gate.diagonal) {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numGroups >= minParallelWork)
+#endif
+    for (std::size_t i = 0; i < numGroups; ++i) {
+      const std::size_t base = indexing.base(i);
+      for (auto r : rows)
+        state[base + offsets[r]] = cmul(state[base + offsets[r]],
+                                        gate.phases[r]);
+    }
+    return;
+  }
+
+#if defined(_OPENMP)
+#pragma omp parallel if (numGroups >= minParallelWork)
+#endif
+  {
+    std::vector<std::complex<ScalarType>> in(rows.size());
+#if defined(_OPENMP)
+#pragma omp for schedule(static)
+#endif
+    for (std::size_t i = 0; i < numGroups; ++i) {
+      const std::size_t base = indexing.base(i);
+      for (std::size_t k = 0; k < rows.size(); ++k)
+        in[k] = state[base + offsets[gate.columns[rows[k]]]];
+      for (std::size_t k = 0; k < rows.size(); ++k)
+        state[base + offsets[rows[k]]] =
+            gate.unitPhases ? in[k] : cmul(gate.phases[rows[k]], in[k]);
+    }
+  }
+}
+
+/// @brief Apply the (row-major) gate `matrix` on `targets`, controlled on
+/// `controls`, to the `2^numQubits` amplitudes in `state`.
+template <typename ScalarType>
+void applyGate(std::complex<ScalarType> *state, std::size_t numQubits,
+               const std::complex<ScalarType> *matrix,
+               const std::vector<std::size_t> &controls,
+               const std::vector<std::size_t> &targets) {
+  // Diagonal and permutation gates (phase gates, X, CZ, SWAP, ...) do not
+  // need the dense matrix-vector product.
+  if (auto monomial = toMonomialGate(matrix, 1ULL << targets.size()))
+    return applyMonomialGate(state, numQubits, *monomial, controls, targets);
+
+  switch (targets.size()) {
+  case 1:
+    return applyGateKernel<1>(state, numQubits, matrix, controls, targets);
+  case 2:
+    return applyGateKernel<2>(state, numQubits, matrix, controls, targets);
+  case 3:
+    return applyGateKernel<3>(state, numQubits, matrix, controls, targets);
+  default:
+    return applyGateKernelGeneric(state, numQubits, matrix, controls,
+                                  targets);
+  }
+}
+
+/// @brief Probability of measuring `qubit` in |1> for the `2^numQubits`
+/// amplitudes in `state`.
+template <typename ScalarType>
+double probabilityOfOne(const std::complex<ScalarType> *state,
+                        std::size_t numQubits, std::size_t qubit) {
+  const std::size_t numPairs = 1ULL << (numQubits - 1);
+  const std::size_t lowMask = (1ULL << qubit) - 1;
+  return reduceSum(numPairs, [=](std::size_t i) {
+    const std::size_t idx = insertZeroBits(i, &lowMask, 1) | (1ULL << qubit);
+    return static_cast<double>(std::norm(state[idx]));
+  });
+}
+
+/// @brief Squared norm of the `size` amplitudes in `state`.
+template <typename ScalarType>
+double squaredNorm(const std::complex<ScalarType> *state, std::size_t size) {
+  return reduceSum(size, [state](std::size_t i) {
+    return static_cast<double>(std::norm(state[i]));
+  });
+}
+
+/// @brief Multiply the `size` amplitudes in `state` by the real `scale`.
+template <typename ScalarType>
+void scaleState(std::complex<ScalarType> *state, std::size_t size,
+                ScalarType scale) {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (size >= minParallelWork)
+#endif
+  for (std::size_t i = 0; i < size; ++i)
+    state[i] *= scale;
+}
+
+/// @brief Number of values of the swapped bits handled together by
+/// `swapQubits`, on each side of the swap.
+inline constexpr std::size_t swapTileSize = 16;
+
+/// @brief Exchange the bit positions of each pair in `swaps` (which must not
+/// share positions) in the amplitude index of the `2^numQubits` amplitudes in
+/// `state`, i.e., apply SWAP gates on them, in a single pass.
+///
+/// With `k` pairs, this transposes the `2^k x 2^k` matrix indexed by the
+/// values of the low and high positions of the pairs, for each value of the
+/// other bits. The transposition goes tile by tile, and for each tile over
+/// the other bits, lowest first, so that the cache lines fetched for a tile
+/// are used fully before they are evicted.
+template <typename ScalarType>
+void swapQubits(std::complex<ScalarType> *state, std::size_t numQubits,
+                std::vector<std::pair<std::size_t, std::size_t>> swaps) {
+  if (swaps.empty())
+    return;
+  // Order the pairs by their low position: the tiles then cover the lowest
+  // swapped bits, which share cache lines.
+  for (auto &[a, b] : swaps)
+    if (a > b)
+      std::swap(a, b);
+  std::sort(swaps.begin(), swaps.end());
+
+  const std::size_t numPairs = swaps.size();
+  const std::size_t dim = 1ULL << numPairs;
+  std::vector<std::size_t> positions;
+  for (auto [low, high] : swaps) {
+    positions.push_back(low);
+    positions.push_back(high);
+  }
+  std::sort(positions.begin(), positions.end());
+  std::vector<std::size_t> insertMasks;
+  for (auto p : positions)
+    insertMasks.push_back((1ULL << p) - 1);
+
+  // Offsets of each value of the low and high positions of the pairs.
+  std::vector<std::size_t> lowOffsets(dim), highOffsets(dim);
+  for (std::size_t v = 0; v < dim; ++v)
+    for (std::size_t k = 0; k < numPairs; ++k)
+      if ((v >> k) & 1) {
+        lowOffsets[v] |= 1ULL << swaps[k].first;
+        highOffsets[v] |= 1ULL << swaps[k].second;
+      }
+
+  // The bits below all the pairs are contiguous runs of amplitudes.
+  const std::size_t runLength = 1ULL << positions.front();
+  const std::size_t numRests =
+      1ULL << (numQubits - positions.size() - positions.front());
+  const std::size_t tile = std::min(swapTileSize, dim);
+  std::vector<std::pair<std::size_t, std::size_t>> tilePairs;
+  for (std::size_t lowTile = 0; lowTile < dim; lowTile += tile)
+    for (std::size_t highTile = lowTile; highTile < dim; highTile += tile)
+      tilePairs.emplace_back(lowTile, highTile);
+  const std::size_t numTasks = tilePairs.size() * numRests;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static)                                      \
+    if (numTasks * tile * tile * runLength >= minParallelWork)
+#endif
+  for (std::size_t task = 0; task < numTasks; ++task) {
+    const auto [lowTile, highTile] = tilePairs[task / numRests];
+    const std::size_t base =
+        insertZeroBits((task % numRests) << positions.front(),
+                       insertMasks.data(), insertMasks.size());
+    for (std::size_t u = highTile; u < highTile + tile; ++u)
+      for (std::size_t v = lowTile; v < std::min(u, lowTile + tile); ++v) {
+        // Value `v` on the low positions and `u` on the high ones goes to
+        // `u` on the low and `v` on the high, and vice versa.
+        auto *a = state + base + lowOffsets[v] + highOffsets[u];
+        auto *b = state + base + lowOffsets[u] + highOffsets[v];
+        std::swap_ranges(a, a + runLength, b);
+      }
+  }
+}
+
+/// @brief Probability of measuring `qubit` in |1> for the `dim x dim`
+/// column-major density matrix `rho`, i.e., the sum of the matching diagonal
+/// entries.
+template <typename ScalarType>
+double probabilityOfOneDiagonal(const std::complex<ScalarType> *rho,
+                                std::size_t dim, std::size_t qubit) {
+  const std::size_t numPairs = dim / 2;
+  const std::size_t lowMask = (1ULL << qubit) - 1;
+  return reduceSum(numPairs, [=](std::size_t i) {
+    const std::size_t idx = insertZeroBits(i, &lowMask, 1) | (1ULL << qubit);
+    return static_cast<double>(rho[idx * dim + idx].real());
+  });
+}
+
+/// @brief Collapse `data` (`2^numBits` elements) onto the subspace where the
+/// bits at `positions` equal the corresponding bits of `value`, scaling the
+/// surviving elements by `scale` and zeroing everything else. If
+/// `resetToZero` is set, the survivors are moved onto the pattern where all
+/// those bits are 0, i.e., the measured qubits are also reset.
+///
+/// For a state vector, `positions` is the measured qubit. For a column-major
+/// density matrix seen as a vector, the row and column bits of the qubit are
+/// both projected.
+template <typename ScalarType>
+void collapse(std::complex<ScalarType> *data, std::size_t numBits,
+              const std::vector<std::size_t> &positions, std::size_t value,
+              ScalarType scale, bool resetToZero) {
+  const GateIndexing indexing(numBits, {}, positions);
+  std::size_t mask = 0;
+  for (auto p : positions)
+    mask |= (1ULL << p);
+  const std::size_t numGroups = indexing.numGroups;
+  const std::size_t destination = resetToZero ? 0 : value;
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numGroups >= minParallelWork)
+#endif
+  for (std::size_t i = 0; i < numGroups; ++i) {
+    const std::size_t base = indexing.base(i);
+    const std::complex<ScalarType> kept = data[base | value] * scale;
+    // Visit all the patterns of the projected bits in this group.
+    for (std::size_t sub = mask;; sub = (sub - 1) & mask) {
+      data[base | sub] = 0;
+      if (sub == 0)
+        break;
+    }
+    data[base | destination] = kept;
+  }
+}
+
+/// @brief Drop the bits at `positions` from the `2^numBits` elements in
+/// `data`, all of whose non-zero elements have those bits set as in `value`:
+/// `out` receives the `2^(numBits - positions.size())` elements with that
+/// pattern, in order.
+///
+/// For a state vector, `positions` is a qubit in a basis state. For a
+/// column-major density matrix seen as a vector, they are the row and
+/// column bits of the qubit.
+template <typename ScalarType>
+void removeBits(const std::complex<ScalarType> *data, std::size_t numBits,
+                const std::vector<std::size_t> &positions, std::size_t value,
+                std::complex<ScalarType> *out) {
+  const GateIndexing indexing(numBits, {}, positions);
+  const std::size_t numGroups = indexing.numGroups;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numGroups >= minParallelWork)
+#endif
+  for (std::size_t i = 0; i < numGroups; ++i)
+    out[i] = data[indexing.base(i) | value];
+}
+
+/// @brief Bitmask form of a Pauli string: `x` holds the qubits acted on by X
+/// or Y, `z` the qubits acted on by Z or Y, and `numY` the number of Y
+/// factors. The string maps `|i>` to `i^numY (-1)^popcount(i & z) |i ^ x>`.
+struct PauliMasks {
+  std::size_t x = 0;
+  std::size_t z = 0;
+  std::size_t numY = 0;
+};
+
+/// @brief Expectation values of the Pauli strings in `terms` over a
+/// `2^numQubits` dimensional state, given `pairValue(i)`, which must return
+/// `conj(psi[i ^ x]) psi[i]` for a state vector or `rho(i, i ^ x)` for a
+/// density matrix, with `x` the X mask passed as its second argument.
+///
+/// Terms that share an X mask are evaluated together in a single pass over
+/// the state, since they only differ by the sign pattern applied to the same
+/// products.
+template <typename PairValueFn>
+std::vector<double> pauliExpectations(PairValueFn &&pairValue,
+                                      std::size_t numQubits,
+                                      const std::vector<PauliMasks> &terms) {
+  std::vector<double> results(terms.size(), 0.0);
+  std::vector<std::pair<std::size_t, std::size_t>> order(terms.size());
+  for (std::size_t t = 0; t < terms.size(); ++t)
+    order[t] = {terms[t].x, t};
+  std::sort(order.begin(), order.end());
+
+  const std::size_t dim = 1ULL << numQubits;
+  const std::size_t numChunks = numReductionChunks(dim);
+  std::vector<std::size_t> zMasks;
+  std::vector<bool> imaginary;
+  std::vector<CompensatedSum> partial;
+  for (std::size_t first = 0; first < order.size();) {
+    const std::size_t x = order[first].first;
+    std::size_t last = first;
+    zMasks.clear();
+    imaginary.clear();
+    for (; last < order.size() && order[last].first == x; ++last) {
+      zMasks.push_back(terms[order[last].second].z);
+      // Only the real part of i^numY times the sum is needed.
+      imaginary.push_back(terms[order[last].second].numY % 2);
+    }
+    const std::size_t numTerms = zMasks.size();
+    partial.assign(numChunks * numTerms, CompensatedSum{});
+
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numChunks > 1)
+#endif
+    for (std::size_t c = 0; c < numChunks; ++c) {
+      CompensatedSum *sums = partial.data() + c * numTerms;
+      const std::size_t end = dim * (c + 1) / numChunks;
+      for (std::size_t i = dim * c / numChunks; i < end; ++i) {
+        const std::complex<double> value = pairValue(i, x);
+        for (std::size_t t = 0; t < numTerms; ++t) {
+          const double part = imaginary[t] ? value.imag() : value.real();
+          sums[t].add(std::popcount(i & zMasks[t]) & 1 ? -part : part);
+        }
+      }
+    }
+
+    // Fold the chunks in order and apply the i^numY phase.
+    for (std::size_t t = 0; t < numTerms; ++t) {
+      CompensatedSum sum;
+      for (std::size_t c = 0; c < numChunks; ++c)
+        sum.add(partial[c * numTerms + t]);
+      const auto &term = terms[order[first + t].second];
+      const double sign = term.numY % 4 == 1 || term.numY % 4 == 2 ? -1 : 1;
+      results[order[first + t].second] = sign * sum.value();
+    }
+    first = last;
+  }
+  return results;
+}
+
+/// @brief Number of elements cleared per `memset` call in `clearState`.
+inline constexpr std::size_t clearChunkSize = 1ULL << 16;
+
+/// @brief Zero `size` amplitudes starting at `data`, in parallel. The chunks
+/// are handed out with a static schedule, so on a freshly allocated buffer
+/// each page is first touched by the thread that applies gates to it.
+template <typename ScalarType>
+void clearState(std::complex<ScalarType> *data, std::size_t size) {
+  const std::size_t numChunks = (size + clearChunkSize - 1) / clearChunkSize;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (numChunks > 1)
+#endif
+  for (std::size_t c = 0; c < numChunks; ++c) {
+    const std::size_t begin = c * clearChunkSize;
+    const std::size_t count = std::min(clearChunkSize, size - begin);
+    std::memset(static_cast<void *>(data + begin), 0,
+                count * sizeof(std::complex<ScalarType>));
+  }
+}
+
+/// @brief Grow a state vector in place to `kron(factor, psi)`, where `psi`
+/// is held in the first `oldDim` elements of `data` and `data` has room for
+/// `oldDim * factorDim` elements. The new qubits are the high bits of the
+/// amplitude index. A null `factor` stands for the |0...0> state, in which
+/// case the new amplitudes are simply zeroed.
+template <typename ScalarType>
+void growState(std::complex<ScalarType> *data, std::size_t oldDim,
+               const std::complex<ScalarType> *factor, std::size_t factorDim) {
+  const std::size_t newDim = oldDim * factorDim;
+  if (!factor) {
+    clearState(data + oldDim, newDim - oldDim);
+    return;
+  }
+
+  // The first block overwrites the original amplitudes, so it goes last.
+  for (std::size_t block = factorDim; block-- > 0;) {
+    const std::complex<ScalarType> scale = factor[block];
+    std::complex<ScalarType> *out = data + block * oldDim;
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (oldDim >= minParallelWork)
+#endif
+    for (std::size_t i = 0; i < oldDim; ++i)
+      out[i] = cmul(scale, data[i]);
+  }
+}
+
+/// @brief Grow a column-major density matrix in place to
+/// `kron(factor, rho)`, where `rho` (`oldDim x oldDim`) is held compactly in
+/// the first `oldDim^2` elements of `data`, `data` has room for the full
+/// `newDim x newDim` result with `newDim = oldDim * factorDim`, and `factor`
+/// is a column-major `factorDim x factorDim` matrix. A null `factor` stands
+/// for |0...0><0...0|.
+///
+/// Every element moves to an index at or above its source, so writing the
+/// result from the last column down never overwrites data still to be read.
+template <typename ScalarType>
+void growDensityMatrix(std::complex<ScalarType> *data, std::size_t oldDim,
+                       const std::complex<ScalarType> *factor,
+                       std::size_t factorDim) {
+  const std::size_t newDim = oldDim * factorDim;
+  for (std::size_t col = newDim; col-- > 0;) {
+    const std::size_t colBlock = col / oldDim;
+    const std::complex<ScalarType> *in = data + (col % oldDim) * oldDim;
+    std::complex<ScalarType> *out = data + col * newDim;
+    const auto fillRows = [&](std::size_t first, std::size_t last) {
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(static) if (last - first >= minParallelWork)
+#endif
+      for (std::size_t row = first; row < last; ++row) {
+        const std::size_t rowBlock = row / oldDim;
+        const std::complex<ScalarType> scale =
+            factor ? factor[rowBlock + colBlock * factorDim]
+                   : std::complex<ScalarType>(rowBlock == 0 && colBlock == 0);
+        out[row] = cmul(scale, in[row % oldDim]);
+      }
+    };
+    // Only the first column reads and writes the same elements: there, the
+    // rows below the original block must be filled before it is scaled.
+    fillRows(oldDim, newDim);
+    fillRows(0, oldDim);
+  }
+}
+
+} // namespace nvqir::kernels
@@ -10,10 +10,16 @@
 #include "nvqir/Gates.h"
 #include "stim.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <bit>
 #include <iostream>
+#include <numeric>
 #include <set>
 #include <span>
+#include <thread>
+#include <unordered_map>
 
 using namespace cudaq;
 
@@ -30,6 +36,10 @@ protected:
   /// @brief Number of measurements performed so far.
   std::size_t num_measurements = 0;
 
+  /// @brief Measurements queued for sampling, in call order, with their index
+  /// in the measurement record.
+  std::vector<std::pair<std::size_t, std::size_t>> queuedMeasurements;
+
   /// @brief Top-level random engine. Stim simulator RNGs are based off of this
   /// engine.
   std::mt19937_64 randomEngine;
@@ -37,31 +47,69 @@ protected:
   /// @brief Stim Tableau simulator (noiseless)
   std::unique_ptr<stim::TableauSimulator<W>> tableau;
 
-  /// @brief Stim Frame/Flip simulator (used to generate multiple shots)
-  std::unique_ptr<stim::FrameSimulator<W>> sampleSim;
+  /// @brief Number of shots per batch when the shots of a sample are split
+  /// into batches. It only depends on the number of shots, never on the
+  /// number of threads, so that a seeded sample is reproducible. This is a
+  /// multiple of every Stim word width.
+  static constexpr std::size_t shotsPerBatch = 4096;
+
+  /// @brief Default number of noise trajectories averaged by `observe` when
+  /// a noise model is set.
+  static constexpr std::size_t defaultNumTrajectories = 1000;
+
+  /// @brief Maximum number of threads the batches of shots are simulated on.
+  std::size_t maxThreads = 1;
+
+  /// @brief Stim Frame/Flip simulators (used to generate multiple shots), one
+  /// per batch of shots. All batches but the last hold a multiple of `W`
+  /// shots.
+  std::vector<std::unique_ptr<stim::FrameSimulator<W>>> sampleSims;
+
+  /// @brief Operations of the kernel that have not been run yet. They are
+  /// only run, in one pass per simulator, once a measurement value is needed.
+  /// `pendingCircuit` goes to the frame simulator, and `pendingTableauCircuit`
+  /// holds the same operations without the noise, for the Tableau simulator.
+  stim::Circuit pendingCircuit;
+  stim::Circuit pendingTableauCircuit;
+
+  /// @brief The operations run so far, with the detector and observable
+  /// annotations, when exporting the detector error model.
+  stim::Circuit recordedCircuit;
+
+  /// @brief The measurements (indices into the measurement record) of each
+  /// detector, and of each logical observable.
+  std::vector<std::vector<std::size_t>> detectors;
+  std::vector<std::vector<std::size_t>> observables;
 
-  std::optional<std::string>
+  /// @brief Scratch buffer for the targets of the operation being appended.
+  std::vector<stim::GateTarget> stimTargets;
+
+  /// @brief Stim gates of the CUDA-Q operations seen so far, without and with
+  /// a control, so that each name is only resolved once.
+  std::unordered_map<std::string, stim::GateType> gateTypes[2];
+
+  std::optional<stim::GateType>
   isValidStimNoiseChannel(const kraus_channel &channel) const {
 
     // Check the old way first
     switch (channel.noise_type) {
     case cudaq::noise_model_type::bit_flip_channel:
     case cudaq::noise_model_type::x_error:
-      return "X_ERROR";
+      return stim::GateType::X_ERROR;
     case cudaq::noise_model_type::y_error:
-      return "Y_ERROR";
+      return stim::GateType::Y_ERROR;
     case cudaq::noise_model_type::phase_flip_channel:
     case cudaq::noise_model_type::z_error:
-      return "Z_ERROR";
+      return stim::GateType::Z_ERROR;
     case cudaq::noise_model_type::depolarization_channel:
     case cudaq::noise_model_type::depolarization1:
-      return "DEPOLARIZE1";
+      return stim::GateType::DEPOLARIZE1;
     case cudaq::noise_model_type::depolarization2:
-      return "DEPOLARIZE2";
+      return stim::GateType::DEPOLARIZE2;
     case cudaq::noise_model_type::pauli1:
-      return "PAULI_CHANNEL_1";
+      return stim::GateType::PAULI_CHANNEL_1;
     case cudaq::noise_model_type::pauli2:
-      return "PAULI_CHANNEL_2";
+      return stim::GateType::PAULI_CHANNEL_2;
     case cudaq::noise_model_type::amplitude_damping_channel:
     case cudaq::noise_model_type::amplitude_damping:
     case cudaq::noise_model_type::phase_damping:
@@ -79,12 +127,62 @@ protected:
   std::size_t getBatchSize() {
     // Default to single shot
     std::size_t batch_size = 1;
-    if (getExecutionContext() && getExecutionContext()->name == "sample" &&
-        !getExecutionContext()->hasConditionalsOnMeasureResults)
-      batch_size = getExecutionContext()->shots;
+    auto *context = getExecutionContext();
+    if (context && context->name == "sample" &&
+        !context->hasConditionalsOnMeasureResults)
+      batch_size = context->shots;
+    // Under noise, each shot of an observe is a noise trajectory.
+    else if (context && context->name == "observe" && context->noiseModel)
+      batch_size = std::max<std::size_t>(
+          1, context->numberTrajectories.value_or(defaultNumTrajectories));
     return batch_size;
   }
 
+  /// @brief Get the sizes of the batches the shots are split into: whole
+  /// words of shots, so that they can be merged by copying words, but the
+  /// last one.
+  std::vector<std::size_t> getShotBatchSizes() {
+    const std::size_t totalShots = getBatchSize();
+    if (totalShots <= shotsPerBatch)
+      return {totalShots};
+    std::vector<std::size_t> sizes;
+    for (std::size_t first = 0; first < totalShots; first += shotsPerBatch)
+      sizes.push_back(std::min(shotsPerBatch, totalShots - first));
+    return sizes;
+  }
+
+  /// @brief Call \p fn with the index of each frame simulator, the batches
+  /// being shared between up to `maxThreads` threads.
+  template <typename Fn>
+  void forEachShotBatch(Fn &&fn) {
+    const std::size_t numThreads = std::min(maxThreads, sampleSims.size());
+    if (numThreads <= 1) {
+      for (std::size_t b = 0; b < sampleSims.size(); ++b)
+        fn(b);
+      return;
+    }
+    std::atomic<std::size_t> nextBatch = 0;
+    std::vector<std::exception_ptr> errors(numThreads);
+    const auto work = [&](std::size_t t) {
+      try {
+        for (std::size_t b = nextBatch++; b < sampleSims.size();
+             b = nextBatch++)
+          fn(b);
+      } catch (...) {
+        errors[t] = std::current_exception();
+      }
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t t = 1; t < numThreads; ++t)
+      workers.emplace_back(work, t);
+    work(0);
+    for (auto &worker : workers)
+      worker.join();
+    for (auto &error : errors)
+      if (error)
+        std::rethrow_exception(error);
+  }
+
   /// @brief Override the default sized allocation of qubits
   /// here to be a bit more efficient than the default implementation
   void addQubitsToState(std::size_t qubitCount,
@@ -102,19 +200,29 @@ protected:
       tableau = std::make_unique<stim::TableauSimulator<W>>(
           std::mt19937_64(randomEngine), /*num_qubits=*/0, /*sign_bias=*/+0);
     }
-    if (!sampleSim) {
-      auto batch_size = getBatchSize();
-      cudaq::info("Creating new Stim frame simulator with batch size {}",
-                  batch_size);
+    if (sampleSims.empty()) {
+      const auto batchSizes = getShotBatchSizes();
+      cudaq::info("Creating {} new Stim frame simulators with batch sizes {}",
+                  batchSizes.size(), batchSizes);
+      // The RNGs of the other batches are seeded from the randomEngine, the
+      // first batch continues the randomEngine stream.
+      std::vector<std::mt19937_64> engines(batchSizes.size());
+      for (std::size_t b = 1; b < batchSizes.size(); ++b) {
+        std::seed_seq seeds{randomEngine(), randomEngine(), randomEngine()};
+        engines[b].seed(seeds);
+      }
       // Bump the randomEngine before cloning and giving to the sample
       // simulator.
       randomEngine.discard(
           std::uniform_int_distribution<int>(1, 30)(randomEngine));
-      sampleSim = std::make_unique<stim::FrameSimulator<W>>(
-          stim::CircuitStats(),
-          stim::FrameSimulatorMode::STORE_MEASUREMENTS_TO_MEMORY, batch_size,
-          std::mt19937_64(randomEngine));
-      sampleSim->reset_all();
+      engines[0] = randomEngine;
+      for (std::size_t b = 0; b < batchSizes.size(); ++b) {
+        sampleSims.push_back(std::make_unique<stim::FrameSimulator<W>>(
+            stim::CircuitStats(),
+            stim::FrameSimulatorMode::STORE_MEASUREMENTS_TO_MEMORY,
+            batchSizes[b], std::move(engines[b])));
+        sampleSims.back()->reset_all();
+      }
     }
   }
 
@@ -123,22 +231,179 @@ protected:
     tableau.reset();
     // Update the randomEngine so that future invocations will use the updated
     // RNG state.
-    if (sampleSim)
-      randomEngine = std::move(sampleSim->rng);
-    sampleSim.reset();
+    if (!sampleSims.empty())
+      randomEngine = std::move(sampleSims.front()->rng);
+    sampleSims.clear();
+    pendingCircuit.clear();
+    pendingTableauCircuit.clear();
+    recordedCircuit.clear();
+    detectors.clear();
+    observables.clear();
+    queuedMeasurements.clear();
     num_measurements = 0;
   }
 
-  /// @brief Apply operation to all Stim simulators.
-  void applyOpToSims(const std::string &gate_name,
-                     const std::vector<uint32_t> &targets) {
-    if (targets.empty())
+  /// @brief Return true if the circuit is recorded to export its detector
+  /// error model.
+  bool isRecordingCircuit() const {
+    return executionContext && executionContext->exportDetectorErrorModel;
+  }
+
+  /// @brief Append the operation \p gate on \p qubits to the pending
+  /// circuits. Noise operations are only applied by the frame simulator.
+  template <typename QubitRange>
+  void appendOp(stim::GateType gate, const QubitRange &qubits,
+                const std::vector<double> &args = {}, bool isNoise = false) {
+    stimTargets.clear();
+    for (auto q : qubits)
+      stimTargets.push_back(
+          stim::GateTarget::qubit(static_cast<std::uint32_t>(q)));
+    if (stimTargets.empty())
+      return;
+    const stim::SpanRef<const stim::GateTarget> targets(
+        stimTargets.data(), stimTargets.data() + stimTargets.size());
+    const stim::SpanRef<const double> argsRef(args.data(),
+                                              args.data() + args.size());
+    // Consecutive operations of the same gate are fused into one instruction.
+    pendingCircuit.safe_append(gate, targets, argsRef);
+    if (!isNoise)
+      pendingTableauCircuit.safe_append(gate, targets, argsRef);
+  }
+
+  /// @brief Run the pending operations, in bulk, on both Stim simulators.
+  void runPendingCircuit() {
+    if (pendingCircuit.operations.empty())
       return;
-    stim::Circuit tempCircuit;
-    cudaq::info("Calling applyOpToSims {} - {}", gate_name, targets);
-    tempCircuit.safe_append_u(gate_name, targets);
-    tableau->safe_do_circuit(tempCircuit);
-    sampleSim->safe_do_circuit(tempCircuit);
+    cudaq::info("[stim] running {} pending instructions",
+                pendingCircuit.operations.size());
+    tableau->safe_do_circuit(pendingTableauCircuit);
+    forEachShotBatch(
+        [&](std::size_t b) { sampleSims[b]->safe_do_circuit(pendingCircuit); });
+    if (isRecordingCircuit())
+      recordedCircuit += pendingCircuit;
+    pendingCircuit.clear();
+    pendingTableauCircuit.clear();
+  }
+
+  /// @brief Get the Stim gate for the CUDA-Q operation \p name, with a
+  /// control if \p controlled is set.
+  stim::GateType getGateType(const std::string &name, bool controlled) {
+    auto &cache = gateTypes[controlled];
+    if (auto iter = cache.find(name); iter != cache.end())
+      return iter->second;
+
+    std::string gateName(name);
+    std::transform(gateName.begin(), gateName.end(), gateName.begin(),
+                   ::toupper);
+
+    // These CUDA-Q rotation gates have the same name as Stim "reset" gates.
+    // Stim is a Clifford simulator, so it doesn't actually support rotational
+    // gates. Throw exceptions if they are encountered here.
+    // TODO - consider adding support for specific rotations (e.g. pi/2).
+    if (gateName == "RX" || gateName == "RY" || gateName == "RZ")
+      throw std::runtime_error(
+          fmt::format("Gate not supported by Stim simulator: {}. Note that "
+                      "Stim can only simulate Clifford gates.",
+                      name));
+    else if (gateName == "SDG")
+      gateName = "S_DAG";
+    if (controlled)
+      gateName = "C" + gateName;
+
+    try {
+      const stim::GateType gate = stim::GATE_DATA.at(gateName).id;
+      cache.emplace(name, gate);
+      return gate;
+    } catch (std::out_of_range &e) {
+      throw std::runtime_error(
+          fmt::format("Gate not supported by Stim simulator: {}. Note that "
+                      "Stim can only simulate Clifford gates.",
+                      e.what()));
+    }
+  }
+
+  /// @brief Get the measurement record indices of the measurements at the
+  /// given \p lookbacks, -1 being the latest measurement. If the circuit is
+  /// recorded, \p gate is appended to it on these measurements.
+  std::vector<std::size_t>
+  getMeasurementIndices(const std::vector<std::int64_t> &lookbacks,
+                        stim::GateType gate, const std::vector<double> &args) {
+    // Measurements queued for sampling are already part of the record, in
+    // call order.
+    flushGateQueue();
+
+    std::vector<std::size_t> indices;
+    std::vector<stim::GateTarget> recTargets;
+    for (auto lookback : lookbacks) {
+      if (lookback >= 0 ||
+          static_cast<std::size_t>(-lookback) > num_measurements)
+        throw std::runtime_error(
+            fmt::format("Invalid measurement record lookback {}, with {} "
+                        "measurements performed.",
+                        lookback, num_measurements));
+      indices.push_back(num_measurements + lookback);
+      recTargets.push_back(
+          stim::GateTarget::rec(static_cast<std::int32_t>(lookback)));
+    }
+
+    if (isRecordingCircuit()) {
+      runPendingCircuit();
+      recordedCircuit.safe_append(
+          gate,
+          stim::SpanRef<const stim::GateTarget>(
+              recTargets.data(), recTargets.data() + recTargets.size()),
+          stim::SpanRef<const double>(args.data(), args.data() + args.size()));
+    }
+    return indices;
+  }
+
+  void addDetector(const std::vector<std::int64_t> &lookbacks) override {
+    detectors.push_back(
+        getMeasurementIndices(lookbacks, stim::GateType::DETECTOR, {}));
+  }
+
+  void addObservable(std::size_t index,
+                     const std::vector<std::int64_t> &lookbacks) override {
+    auto indices = getMeasurementIndices(
+        lookbacks, stim::GateType::OBSERVABLE_INCLUDE,
+        {static_cast<double>(index)});
+    if (observables.size() <= index)
+      observables.resize(index + 1);
+    observables[index].insert(observables[index].end(), indices.begin(),
+                              indices.end());
+  }
+
+  /// @brief Add the register \p registerName to the results, with one bit
+  /// per group of \p groups: the parity of its measurements in each shot,
+  /// relative to the noiseless reference. These are the bits flipped by noise
+  /// in the frame simulators, so they are read from their records directly.
+  void reportParities(const std::vector<std::vector<std::size_t>> &groups,
+                      const std::string &registerName,
+                      const std::vector<std::size_t> &firstShots,
+                      std::size_t nShots, std::size_t shots) {
+    stim::simd_bit_table<W> parities(groups.size(), nShots);
+    forEachShotBatch([&](std::size_t b) {
+      const auto &record = sampleSims[b]->m_record.storage;
+      // All batches but the last hold whole words of shots.
+      const std::size_t firstWord = firstShots[b] / W;
+      const std::size_t numWords = (sampleSims[b]->batch_size + W - 1) / W;
+      for (std::size_t g = 0; g < groups.size(); g++)
+        for (auto m : groups[g])
+          parities[g].word_range_ref(firstWord, numWords) ^=
+              record[m].word_range_ref(0, numWords);
+    });
+
+    auto table =
+        std::make_shared<stim::simd_bit_table<W>>(parities.transposed());
+    PackedShots packed;
+    packed.numShots = shots;
+    packed.numBits = groups.size();
+    packed.rowStride = table->num_simd_words_minor * (W / 64);
+    packed.words = table->data.u64;
+    packed.storage = table;
+    ExecutionResult result(registerName);
+    result.packedShots = std::move(packed);
+    executionContext->result.append(result);
   }
 
   /// @brief Apply the noise channel on \p qubits
@@ -157,14 +422,6 @@ protected:
     // Get the name as a string
     std::string gName(gateName);
 
-    // Cast size_t to uint32_t
-    std::vector<std::uint32_t> stimTargets;
-    stimTargets.reserve(controls.size() + targets.size());
-    for (auto q : controls)
-      stimTargets.push_back(static_cast<std::uint32_t>(q));
-    for (auto q : targets)
-      stimTargets.push_back(static_cast<std::uint32_t>(q));
-
     // Get the Kraus channels specified for this gate and qubits
     auto krausChannels = executionContext->noiseModel->get_channels(
         gName, targets, controls, params);
@@ -173,18 +430,15 @@ protected:
     if (krausChannels.empty())
       return;
 
+    std::vector<std::size_t> qubits(controls);
+    qubits.insert(qubits.end(), targets.begin(), targets.end());
     cudaq::info("Applying {} kraus channels to qubits {}", krausChannels.size(),
-                stimTargets);
+                qubits);
 
-    stim::Circuit noiseOps;
     for (auto &channel : krausChannels) {
-      if (auto stimName = isValidStimNoiseChannel(channel))
-        noiseOps.safe_append_u(stimName.value(), stimTargets,
-                               channel.parameters);
+      if (auto gate = isValidStimNoiseChannel(channel))
+        appendOp(*gate, qubits, channel.parameters, /*isNoise=*/true);
     }
-    // Only apply the noise operations to the sample simulator (not the Tableau
-    // simulator).
-    sampleSim->safe_do_circuit(noiseOps);
   }
 
   bool isValidNoiseChannel(const cudaq::noise_model_type &type) const override {
@@ -197,54 +451,25 @@ protected:
                   const std::vector<std::size_t> &qubits) override {
     flushGateQueue();
     cudaq::info("[stim] apply kraus channel {}", channel.get_type_name());
-    stim::Circuit noiseOps;
-    std::vector<std::uint32_t> stimTargets;
-    stimTargets.reserve(qubits.size());
-    for (auto q : qubits)
-      stimTargets.push_back(static_cast<std::uint32_t>(q));
 
     // If we have a valid operation, apply it
-    if (auto stimName = isValidStimNoiseChannel(channel)) {
-      noiseOps.safe_append_u(stimName.value(), stimTargets, channel.parameters);
-      sampleSim->safe_do_circuit(noiseOps);
-    }
+    if (auto gate = isValidStimNoiseChannel(channel))
+      appendOp(*gate, qubits, channel.parameters, /*isNoise=*/true);
   }
 
   void applyGate(const GateApplicationTask &task) override {
-    std::string gateName(task.operationName);
-    std::transform(gateName.begin(), gateName.end(), gateName.begin(),
-                   ::toupper);
-    std::vector<std::uint32_t> stimTargets;
-
-    // These CUDA-Q rotation gates have the same name as Stim "reset" gates.
-    // Stim is a Clifford simulator, so it doesn't actually support rotational
-    // gates. Throw exceptions if they are encountered here.
-    // TODO - consider adding support for specific rotations (e.g. pi/2).
-    if (gateName == "RX" || gateName == "RY" || gateName == "RZ")
-      throw std::runtime_error(
-          fmt::format("Gate not supported by Stim simulator: {}. Note that "
-                      "Stim can only simulate Clifford gates.",
-                      task.operationName));
-    else if (gateName == "SDG")
-      gateName = "S_DAG";
-
+    const stim::GateType gate =
+        getGateType(task.operationName, !task.controls.empty());
     if (task.controls.size() > 1)
       throw std::runtime_error(
           "Gates with >1 controls not supported by Stim simulator");
-    if (task.controls.size() >= 1)
-      gateName = "C" + gateName;
-    for (auto c : task.controls)
-      stimTargets.push_back(c);
-    for (auto t : task.targets)
-      stimTargets.push_back(t);
-    try {
-      applyOpToSims(gateName, stimTargets);
-    } catch (std::out_of_range &e) {
-      throw std::runtime_error(
-          fmt::format("Gate not supported by Stim simulator: {}. Note that "
-                      "Stim can only simulate Clifford gates.",
-                      e.what()));
+    if (task.controls.empty()) {
+      appendOp(gate, task.targets);
+      return;
     }
+    std::vector<std::size_t> qubits(task.controls);
+    qubits.insert(qubits.end(), task.targets.begin(), task.targets.end());
+    appendOp(gate, qubits);
   }
 
   /// @brief Set the current state back to the |0> state.
@@ -258,9 +483,10 @@ protected:
 
   /// @brief Measure the qubit and return the result.
   bool measureQubit(const std::size_t index) override {
-    // Perform measurement
-    applyOpToSims(
-        "M", std::vector<std::uint32_t>{static_cast<std::uint32_t>(index)});
+    // Perform measurement. Its value is needed now, so run everything up to
+    // and including it.
+    appendOp(stim::GateType::M, std::array<std::size_t, 1>{index});
+    runPendingCircuit();
     num_measurements++;
 
     // Get the tableau bit that was just generated.
@@ -268,8 +494,8 @@ protected:
     const bool tableauBit = *v.crbegin();
 
     // Get the mid-circuit sample to be XOR-ed with tableauBit.
-    bool sampleSimBit =
-        sampleSim->m_record.storage[num_measurements - 1][/*shot=*/0];
+    const auto &record = sampleSims.front()->m_record.storage;
+    bool sampleSimBit = record[num_measurements - 1][/*shot=*/0];
 
     // Calculate the result.
     bool result = tableauBit ^ sampleSimBit;
@@ -288,6 +514,19 @@ public:
     // simulator knows how to buffer the results across multiple sample()
     // invocations.
     supportsBufferedSample = true;
+
+    // Batches of shots are simulated on this many threads at most.
+    maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (auto *threadsEnvVar = std::getenv("CUDAQ_STIM_NUM_THREADS")) {
+      const int numThreads = std::atoi(threadsEnvVar);
+      if (numThreads <= 0)
+        throw std::runtime_error(
+            fmt::format("Invalid CUDAQ_STIM_NUM_THREADS environment variable "
+                        "setting. Expecting a positive integer value, got "
+                        "'{}'.",
+                        threadsEnvVar));
+      maxThreads = numThreads;
+    }
   }
   virtual ~StimCircuitSimulator() = default;
 
@@ -295,15 +534,163 @@ public:
     randomEngine = std::mt19937_64(seed);
   }
 
-  bool canHandleObserve() override { return false; }
+  using CircuitSimulatorBase::mz;
+
+  /// @brief Measure operation. Measurements only queued for sampling are
+  /// still appended to the measurement record right away, so that the record
+  /// follows the order of the calls, whatever order they are sampled in.
+  bool mz(const std::size_t qubitIdx,
+          const std::string &registerName) override {
+    const bool queued = executionContext &&
+                        executionContext->name == "sample" &&
+                        !executionContext->hasConditionalsOnMeasureResults;
+    const bool result = CircuitSimulatorBase::mz(qubitIdx, registerName);
+    if (queued) {
+      appendOp(stim::GateType::M, std::array<std::size_t, 1>{qubitIdx});
+      queuedMeasurements.emplace_back(qubitIdx, num_measurements++);
+    }
+    return result;
+  }
+
+  bool canHandleObserve() override {
+    // Do not compute <H> from the stabilizer state if shots based sampling
+    // was requested.
+    if (executionContext &&
+        executionContext->shots != static_cast<std::size_t>(-1))
+      return false;
+
+    // Without shots, all the terms are computed at once from the stabilizer
+    // state by default, unless CUDAQ_OBSERVE_FROM_SAMPLING asks otherwise.
+    return !shouldObserveFromSampling(/*defaultConfig=*/false);
+  }
+
+  /// @brief Compute the expectation value of \p op on the stabilizer state.
+  /// In the noiseless reference state of the Tableau simulator, each Pauli
+  /// term has an exact expectation of 0 or +-1. Each frame simulator shot
+  /// holds the Pauli error noise applied on top of that state, which flips
+  /// the sign of a term it anticommutes with, so the noisy expectation is the
+  /// reference one averaged over the shots.
+  cudaq::observe_result observe(const cudaq::spin_op &op) override {
+    flushGateQueue();
+    runPendingCircuit();
+
+    // The qubits on which the Pauli of each term has an X (resp. Z) part, and
+    // the expectation of the term in the reference state.
+    std::vector<std::vector<std::size_t>> xQubits, zQubits;
+    std::vector<int> references;
+    std::vector<std::complex<double>> coefficients;
+    for (const auto &term : op) {
+      stim::PauliString<W> pauli(nQubitsAllocated);
+      auto &xs = xQubits.emplace_back();
+      auto &zs = zQubits.emplace_back();
+      for (const auto &p : term) {
+        const auto type = p.as_pauli();
+        if (type == cudaq::pauli::I)
+          continue;
+        const std::size_t target = p.target();
+        if (target >= nQubitsAllocated)
+          throw std::runtime_error(fmt::format(
+              "observe: operator acts on qubit {} but the state only has {} "
+              "qubits",
+              target, nQubitsAllocated));
+        if (type != cudaq::pauli::Z) {
+          pauli.xs[target] = true;
+          xs.push_back(target);
+        }
+        if (type != cudaq::pauli::X) {
+          pauli.zs[target] = true;
+          zs.push_back(target);
+        }
+      }
+      references.push_back(xs.empty() && zs.empty()
+                               ? 1
+                               : tableau->peek_observable_expectation(pauli));
+      coefficients.push_back(term.evaluate_coefficient());
+    }
+
+    // The results of mid-circuit measurements were those of the first shot,
+    // so the other shots may not follow the control flow of the kernel.
+    const bool firstShotOnly = num_measurements > 0;
+    std::size_t numShots = 0;
+    for (auto &sim : sampleSims)
+      numShots += sim->batch_size;
+    if (numShots == 0)
+      numShots = 1;
+    if (firstShotOnly && numShots > 1) {
+      cudaq::info("[stim] kernel has measurements, computing <H> from a "
+                  "single noise trajectory.");
+      numShots = 1;
+    }
+
+    // Count, in one pass over the frames of each batch, the shots whose
+    // error anticommutes with each term. The random Z parts Stim adds to the
+    // frames are stabilizers of the reference state, so they commute with
+    // every term of non-zero expectation.
+    std::vector<std::vector<std::size_t>> flips(
+        sampleSims.size(), std::vector<std::size_t>(references.size()));
+    forEachShotBatch([&](std::size_t b) {
+      const auto &sim = *sampleSims[b];
+      const std::size_t batchShots =
+          firstShotOnly ? (b == 0 ? 1 : 0) : sim.batch_size;
+      if (batchShots == 0)
+        return;
+      stim::simd_bits<W> signs(sim.batch_size);
+      for (std::size_t t = 0; t < references.size(); t++) {
+        if (references[t] == 0)
+          continue;
+        signs.clear();
+        for (auto q : xQubits[t])
+          if (q < sim.num_qubits)
+            signs ^= sim.z_table[q];
+        for (auto q : zQubits[t])
+          if (q < sim.num_qubits)
+            signs ^= sim.x_table[q];
+        std::size_t count = signs.popcount();
+        for (std::size_t s = batchShots; s < signs.num_bits_padded(); s++)
+          count -= signs[s];
+        flips[b][t] = count;
+      }
+    });
+
+    double ee = 0.0;
+    for (std::size_t t = 0; t < references.size(); t++) {
+      std::size_t numFlips = 0;
+      for (auto &batchFlips : flips)
+        numFlips += batchFlips[t];
+      const double flipRate = static_cast<double>(numFlips) / numShots;
+      const double value = references[t] * (1.0 - 2.0 * flipRate);
+      ee += (coefficients[t] * value).real();
+    }
+
+    return cudaq::observe_result(
+        ee, op,
+        cudaq::sample_result(cudaq::ExecutionResult({}, op.to_string(), ee)));
+  }
+
+  /// @brief Return the detector error model of the recorded circuit, in the
+  /// Stim text format.
+  std::string getDetectorErrorModel() const {
+    try {
+      return stim::ErrorAnalyzer::circuit_to_detector_error_model(
+                 recordedCircuit, /*decompose_errors=*/false,
+                 /*fold_loops=*/true, /*allow_gauge_detectors=*/false,
+                 /*approximate_disjoint_errors_threshold=*/1,
+                 /*ignore_decomposition_failures=*/false,
+                 /*block_decomposition_from_introducing_remnant_edges=*/false)
+          .str();
+    } catch (std::invalid_argument &e) {
+      throw std::runtime_error(fmt::format(
+          "Cannot build the detector error model of the kernel: {}",
+          e.what()));
+    }
+  }
 
   /// @brief Reset the qubit
   /// @param index 0-based index of qubit to reset
   void resetQubit(const std::size_t index) override {
     flushGateQueue();
     flushAnySamplingTasks();
-    applyOpToSims(
-        "R", std::vector<std::uint32_t>{static_cast<std::uint32_t>(index)});
+    appendOp(stim::GateType::R, std::array<std::size_t, 1>{index});
   }
 
   /// @brief Sample the multi-qubit state. If \p qubits is empty and
@@ -322,13 +709,28 @@ public:
         return qubits.empty();
       return true;
     }();
-    assert(shots <= sampleSim->batch_size);
-    std::vector<std::uint32_t> stimTargetQubits(qubits.begin(), qubits.end());
-    applyOpToSims("M", stimTargetQubits);
-    num_measurements += stimTargetQubits.size();
+    assert(shots <= getBatchSize());
+    // Get the record index of the latest measurement of each qubit, measuring
+    // the ones not measured yet.
+    std::vector<std::size_t> indices;
+    for (auto qubit : qubits) {
+      auto iter = std::find_if(
+          queuedMeasurements.rbegin(), queuedMeasurements.rend(),
+          [&](const auto &queued) { return queued.first == qubit; });
+      if (iter != queuedMeasurements.rend()) {
+        indices.push_back(iter->second);
+        continue;
+      }
+      appendOp(stim::GateType::M, std::array<std::size_t, 1>{qubit});
+      indices.push_back(num_measurements++);
+    }
+    queuedMeasurements.clear();
 
+    // Measurements whose results are not reported yet stay in the pending
+    // circuit.
     if (!populateResult)
       return cudaq::ExecutionResult();
+    runPendingCircuit();
 
     // Generate a reference sample
     const std::vector<bool> &v = tableau->measurement_record.storage;
@@ -337,38 +739,73 @@ public:
       ref[k] ^= v[k];
 
     // Now XOR results on a per-shot basis
-    stim::simd_bit_table<W> sample = sampleSim->m_record.storage;
-    auto nShots = sampleSim->batch_size;
+    std::size_t nShots = 0;
+    std::vector<std::size_t> firstShots;
+    for (auto &sim : sampleSims) {
+      firstShots.push_back(nShots);
+      nShots += sim->batch_size;
+    }
 
     // This is a slightly modified version of `sample_batch_measurements`, where
-    // we already have the `sample` from the frame simulator. It also places the
-    // `sample` in a layout amenable to the order of the loops below (shot
-    // major).
-    sample = sample.transposed();
+    // we already have the `sample` from the frame simulators. It also places
+    // the `sample` in the layout of the packed result (shot major), with the
+    // batches one after the other.
+    auto table =
+        std::make_shared<stim::simd_bit_table<W>>(nShots, num_measurements);
+    auto &sample = *table;
+    forEachShotBatch([&](std::size_t b) {
+      const auto batch = sampleSims[b]->m_record.storage.transposed();
+      for (std::size_t s = 0; s < sampleSims[b]->batch_size; s++)
+        sample[firstShots[b] + s] =
+            batch[s].word_range_ref(0, sample.num_simd_words_minor);
+    });
     if (ref.not_zero())
       for (size_t s = 0; s < nShots; s++)
         sample[s].word_range_ref(0, ref.num_simd_words) ^= ref;
 
-    size_t bits_per_sample = num_measurements;
-    std::vector<std::string> sequentialData;
-    // Only retain the final "qubits.size()" measurements. All other
-    // measurements were mid-circuit measurements that have been previously
-    // accounted for and saved.
-    assert(bits_per_sample >= qubits.size());
-    std::size_t first_bit_to_save = executionContext->explicitMeasurements
-                                        ? 0
-                                        : bits_per_sample - qubits.size();
-    CountsDictionary counts;
-    sequentialData.reserve(shots);
-    for (std::size_t shot = 0; shot < shots; shot++) {
-      std::string aShot(bits_per_sample - first_bit_to_save, '0');
-      for (std::size_t b = first_bit_to_save; b < bits_per_sample; b++)
-        aShot[b - first_bit_to_save] = sample[shot][b] ? '1' : '0';
-      counts[aShot]++;
-      sequentialData.push_back(std::move(aShot));
+    // Explicit measurements report the whole record. Otherwise, only the
+    // measurements of \p qubits are retained, all other measurements were
+    // mid-circuit measurements that have been previously accounted for and
+    // saved.
+    if (executionContext->explicitMeasurements) {
+      indices.resize(num_measurements);
+      std::iota(indices.begin(), indices.end(), 0);
+    }
+    const bool contiguous =
+        std::adjacent_find(indices.begin(), indices.end(),
+                           [](std::size_t a, std::size_t b) {
+                             return b != a + 1;
+                           }) == indices.end();
+    // Measurements out of record order are gathered in a new table.
+    auto reported = table;
+    if (!contiguous) {
+      reported =
+          std::make_shared<stim::simd_bit_table<W>>(nShots, indices.size());
+      for (std::size_t s = 0; s < nShots; s++)
+        for (std::size_t i = 0; i < indices.size(); i++)
+          (*reported)[s][i] = static_cast<bool>(sample[s][indices[i]]);
+      std::iota(indices.begin(), indices.end(), 0);
     }
-    ExecutionResult result(counts);
-    result.sequentialData = std::move(sequentialData);
+
+    // Hand the table over as is, the bit strings of the shots are only built
+    // if the sequential data is requested.
+    PackedShots packed;
+    packed.numShots = shots;
+    packed.numBits = indices.size();
+    packed.bitOffset = indices.empty() ? 0 : indices.front();
+    packed.rowStride = reported->num_simd_words_minor * (W / 64);
+    packed.words = reported->data.u64;
+    packed.storage = reported;
+    ExecutionResult result(packed.counts());
+    result.packedShots = std::move(packed);
+
+    if (!detectors.empty())
+      reportParities(detectors, "__detectors__", firstShots, nShots, shots);
+    if (!observables.empty())
+      reportParities(observables, "__observables__", firstShots, nShots,
+                     shots);
+    if (isRecordingCircuit())
+      executionContext->detectorErrorModel = getDetectorErrorModel();
     return result;
   }
 
@@ -0,0 +1,43 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+// clang-format off
+// RUN: cudaq-quake %cpp_std %s | cudaq-opt | FileCheck --check-prefixes=CHECK,ALIVE %s
+// RUN: cudaq-quake %cpp_std %s | cudaq-opt -erase-noise | FileCheck --check-prefixes=CHECK,DEAD %s
+// RUN: cudaq-quake %cpp_std %s | cudaq-opt | cudaq-translate --convert-to=qir | FileCheck --check-prefix=QIR %s
+// clang-format on
+
+#include <cudaq.h>
+
+struct testDetector {
+  void operator()() __qpu__ {
+    cudaq::qvector q(2);
+    mz(q[0]);
+    mz(q[1]);
+    cudaq::detector({-1, -2});
+    cudaq::logical_observable(0, {-1});
+  }
+};
+
+// clang-format off
+// CHECK-LABEL:   func.func @__nvqpp__mlirgen__testDetector() attributes
+// CHECK:           quake.mz
+// CHECK:           quake.mz
+// ALIVE:           quake.detector %{{.*}} : !cc.stdvec<i64>
+// ALIVE:           quake.observable_include %{{.*}}, %{{.*}} : i64, !cc.stdvec<i64>
+// DEAD-NOT:        quake.detector
+// DEAD-NOT:        quake.observable_include
+// CHECK:           return
+// CHECK:         }
+
+// QIR-LABEL: define void @__nvqpp__mlirgen__testDetector()
+// QIR:         call void @__quantum__qis__detector(i64* {{.*}}, i64 {{.*}})
+// QIR:         call void @__quantum__qis__observable_include(i64 0, i64* {{.*}}, i64 {{.*}})
+// QIR:         ret void
+// QIR:       }
+// clang-format on
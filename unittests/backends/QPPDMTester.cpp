@@ -129,3 +129,205 @@ CUDAQ_TEST(QPPTester, checkDensityOrderingBug) {
     EXPECT_EQ(0, qppBackend.mz(q3));
   }
 }
+
+CUDAQ_TEST(QPPTester, checkObservePauliSum) {
+  QppNoiseCircuitSimulator qppBackend;
+  auto qubits = qppBackend.allocateQubits(3);
+  // Bell pair on qubits 0 and 1, and ry(0.4) on qubit 2.
+  qppBackend.h(qubits[0]);
+  qppBackend.x({qubits[0]}, qubits[1]);
+  qppBackend.ry(0.4, qubits[2]);
+
+  auto op = 2.0 * cudaq::spin_op::z(0) * cudaq::spin_op::z(1) +
+            0.5 * cudaq::spin_op::x(0) * cudaq::spin_op::x(1) -
+            cudaq::spin_op::y(0) * cudaq::spin_op::y(1) +
+            3.0 * cudaq::spin_op::z(2) + cudaq::spin_op::x(2) +
+            cudaq::spin_op::z(0);
+  auto result = qppBackend.observe(cudaq::spin_op::canonicalize(op));
+  const double want = 2.0 + 0.5 + 1.0 + 3.0 * std::cos(0.4) + std::sin(0.4);
+  EXPECT_NEAR(want, result.expectation(), 1e-9);
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkPhaseAndPermutationGates) {
+  const auto runCircuit = [](auto &qppBackend) {
+    auto qubits = qppBackend.allocateQubits(3);
+    for (auto q : qubits)
+      qppBackend.h(q);
+    qppBackend.s(qubits[0]);
+    qppBackend.t(qubits[1]);
+    qppBackend.rz(0.4, qubits[2]);
+    qppBackend.z({qubits[0]}, qubits[2]);
+    qppBackend.r1(0.7, {qubits[2]}, qubits[1]);
+    qppBackend.y(qubits[1]);
+    qppBackend.x({qubits[1]}, qubits[0]);
+    qppBackend.swap({}, qubits[0], qubits[2]);
+    auto state = qppBackend.getStateVector();
+    qppBackend.deallocateQubits(qubits);
+    return state;
+  };
+
+  nvqir::QppCircuitSimulator<qpp::ket> ketBackend;
+  qpp::ket psi = runCircuit(ketBackend);
+  QppNoiseCircuitSimulator dmBackend;
+  qpp::cmat rho = runCircuit(dmBackend);
+  EXPECT_TRUE(rho.isApprox(psi * psi.adjoint(), 1e-12));
+}
+
+CUDAQ_TEST(QPPTester, checkDenseGates) {
+  const auto runCircuit = [](auto &qppBackend) {
+    auto qubits = qppBackend.allocateQubits(3);
+    qppBackend.h(qubits[0]);
+    qppBackend.rx(0.3, qubits[1]);
+    qppBackend.ry(1.1, qubits[2]);
+    qppBackend.h({qubits[0]}, qubits[2]);
+    qppBackend.rx(0.9, {qubits[2]}, qubits[1]);
+    qppBackend.ry(-0.5, {qubits[0], qubits[1]}, qubits[2]);
+    qppBackend.u3(0.2, 0.4, 0.6, qubits[0]);
+    auto state = qppBackend.getStateVector();
+    qppBackend.deallocateQubits(qubits);
+    return state;
+  };
+
+  nvqir::QppCircuitSimulator<qpp::ket> ketBackend;
+  qpp::ket psi = runCircuit(ketBackend);
+  QppNoiseCircuitSimulator dmBackend;
+  qpp::cmat rho = runCircuit(dmBackend);
+  EXPECT_TRUE(rho.isApprox(psi * psi.adjoint(), 1e-12));
+}
+
+CUDAQ_TEST(QPPTester, checkGrowDensityMatrix) {
+  QppNoiseCircuitSimulator qppBackend;
+  auto qubits = qppBackend.allocateQubits(2);
+  qppBackend.h(qubits[0]);
+  qppBackend.x({qubits[0]}, qubits[1]);
+  qpp::cmat rho = qppBackend.getStateVector();
+
+  // New qubits in |0> are the most significant ones.
+  auto zeroQubit = qppBackend.allocateQubit();
+  qpp::cmat want = qpp::kron(getZeroDensityMatrix(1), rho);
+  EXPECT_TRUE(want.isApprox(qppBackend.getStateVector(), 1e-12));
+
+  // New qubits in a user-provided state.
+  qpp::ket psi(4);
+  psi << 0.5, std::complex<double>(0, 0.5), -0.5, 0.5;
+  auto initQubits = qppBackend.allocateQubits(
+      2, psi.data(), cudaq::simulation_precision::fp64);
+  want = qpp::kron(qpp::cmat(psi * psi.adjoint()), want);
+  EXPECT_TRUE(want.isApprox(qppBackend.getStateVector(), 1e-12));
+  qppBackend.deallocateQubits(initQubits);
+  qppBackend.deallocate(zeroQubit);
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkNoiseChannels) {
+  using RowMajor = Eigen::Matrix<std::complex<double>, Eigen::Dynamic,
+                                 Eigen::Dynamic, Eigen::RowMajor>;
+  const auto toMatrix = [](const cudaq::kraus_op &op) -> qpp::cmat {
+    return Eigen::Map<const RowMajor>(op.data.data(), op.nRows, op.nCols);
+  };
+  const qpp::cmat I = qpp::cmat::Identity(2, 2);
+  qpp::cmat X(2, 2), H(2, 2), RY(2, 2);
+  X << 0, 1, 1, 0;
+  H << M_SQRT1_2, M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2;
+  RY << std::cos(0.15), -std::sin(0.15), std::sin(0.15), std::cos(0.15);
+  // Full-space matrices use the CUDA-Q ordering: qubit 0 is the low bit.
+  // The two-qubit channel puts its first qubit (qubit 0) in the high bit.
+  qpp::cmat CX = qpp::cmat::Zero(4, 4), SWAP = qpp::cmat::Zero(4, 4);
+  for (int b1 = 0; b1 < 2; ++b1)
+    for (int b0 = 0; b0 < 2; ++b0) {
+      CX(((b1 ^ b0) << 1) | b0, (b1 << 1) | b0) = 1;
+      SWAP((b0 << 1) | b1, (b1 << 1) | b0) = 1;
+    }
+
+  cudaq::depolarization_channel depol(0.1);
+  qpp::cmat K0 = std::sqrt(0.7) * qpp::cmat::Identity(4, 4);
+  qpp::cmat K1 = std::sqrt(0.3) * qpp::kron(X, I);
+  std::vector<cudaq::kraus_op> ops;
+  for (const qpp::cmat &K : {K0, K1}) {
+    RowMajor rowMajor = K;
+    ops.emplace_back(std::vector<std::complex<double>>(
+        rowMajor.data(), rowMajor.data() + rowMajor.size()));
+  }
+  cudaq::kraus_channel cxNoise(ops);
+  cudaq::amplitude_damping_channel damping(0.25);
+  cudaq::noise_model noise;
+  noise.add_channel("h", {0}, depol);
+  noise.add_channel("x", {0, 1}, cxNoise);
+
+  QppNoiseCircuitSimulator qppBackend;
+  nvqir::CircuitSimulator &simulator = qppBackend;
+  cudaq::ExecutionContext ctx("sample", 1);
+  ctx.noiseModel = &noise;
+  qppBackend.setExecutionContext(&ctx);
+  auto qubits = qppBackend.allocateQubits(2);
+  qppBackend.h(qubits[0]);
+  qppBackend.ry(0.3, qubits[1]);
+  qppBackend.x({qubits[0]}, qubits[1]);
+  simulator.applyNoise(damping, {qubits[1]});
+  qpp::cmat rho = qppBackend.getStateVector();
+
+  const auto applyChannel = [&](const qpp::cmat &in,
+                                const cudaq::kraus_channel &channel,
+                                const auto &embed) {
+    qpp::cmat out = qpp::cmat::Zero(4, 4);
+    for (const auto &op : channel.get_ops()) {
+      qpp::cmat K = embed(toMatrix(op));
+      out += K * in * K.adjoint();
+    }
+    return out;
+  };
+  qpp::cmat want = getZeroDensityMatrix(2);
+  qpp::cmat U = qpp::kron(I, H);
+  want = U * want * U.adjoint();
+  want = applyChannel(want, depol,
+                      [&](const qpp::cmat &K) { return qpp::kron(I, K); });
+  U = CX * qpp::kron(RY, I);
+  want = U * want * U.adjoint();
+  want = applyChannel(want, cxNoise, [&](const qpp::cmat &K) {
+    return qpp::cmat(SWAP * K * SWAP);
+  });
+  want = applyChannel(want, damping,
+                      [&](const qpp::cmat &K) { return qpp::kron(K, I); });
+  EXPECT_TRUE(want.isApprox(rho, 1e-12));
+  qppBackend.resetExecutionContext();
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkGateFusionWithNoise) {
+  // Gates with noise channels end the fused blocks, so the noise is applied
+  // at the same points as without fusion.
+  cudaq::noise_model noise;
+  noise.add_channel("h", {1}, cudaq::depolarization_channel(0.2));
+  noise.add_channel("rz", {1}, cudaq::amplitude_damping_channel(0.3));
+  const auto runCircuit = [&](QppNoiseCircuitSimulator &qppBackend) {
+    cudaq::ExecutionContext ctx("sample", 1);
+    ctx.noiseModel = &noise;
+    qppBackend.setExecutionContext(&ctx);
+    auto qubits = qppBackend.allocateQubits(3);
+    for (int layer = 0; layer < 2; ++layer) {
+      qppBackend.ry(0.3 + layer, qubits[0]);
+      qppBackend.rx(0.5, qubits[1]);
+      qppBackend.h(qubits[1]);
+      qppBackend.rz(0.7, qubits[1]);
+      qppBackend.x({qubits[0]}, qubits[1]);
+      qppBackend.ry(0.2, qubits[1]);
+      qppBackend.x({qubits[1]}, qubits[2]);
+      qppBackend.t(qubits[2]);
+    }
+    qpp::cmat rho = qppBackend.getStateVector();
+    qppBackend.resetExecutionContext();
+    qppBackend.deallocateQubits(qubits);
+    return rho;
+  };
+
+  QppNoiseCircuitSimulator unfusedBackend;
+  qpp::cmat want = runCircuit(unfusedBackend);
+  // The noise was applied: the state is mixed.
+  EXPECT_LT((want * want).trace().real(), 0.99);
+
+  setenv("CUDAQ_FUSION_MAX_QUBITS", "3", 1);
+  QppNoiseCircuitSimulator fusedBackend;
+  unsetenv("CUDAQ_FUSION_MAX_QUBITS");
+  EXPECT_TRUE(want.isApprox(runCircuit(fusedBackend), 1e-12));
+}
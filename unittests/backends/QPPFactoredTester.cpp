@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "CUDAQTestUtils.h"
+#include "FactoredCircuitSimulator.cpp"
+
+using namespace nvqir;
+
+namespace {
+class TestFactoredSimulator : public FactoredCircuitSimulator {
+public:
+  std::size_t numFactors() {
+    flushGateQueue();
+    return factors.size();
+  }
+
+  qpp::ket getStateVector() {
+    flushGateQueue();
+    FactoredState state(std::vector<QubitFactor>(factors), factorOf.size());
+    return state.stateVector();
+  }
+};
+
+void expectNearKets(const qpp::ket &want, const qpp::ket &got,
+                    double epsilon = 1e-9) {
+  ASSERT_EQ(want.size(), got.size());
+  for (Eigen::Index i = 0; i < want.size(); ++i)
+    EXPECT_NEAR(0.0, std::abs(want(i) - got(i)), epsilon);
+}
+} // namespace
+
+// Gates that merge factors in any order must give the same state as the
+// full state vector simulator.
+CUDAQ_TEST(QPPFactoredTester, checkMergedFactors) {
+  const auto runCircuit = [](auto &backend) {
+    auto qubits = backend.allocateQubits(6);
+    backend.h(qubits[4]);
+    backend.ry(0.3, qubits[1]);
+    backend.x({qubits[4]}, qubits[2]);
+    backend.x({qubits[1]}, qubits[5]);
+    backend.rz(0.2, qubits[2]);
+    backend.x({qubits[5]}, qubits[4]);
+    backend.swap({qubits[2]}, qubits[0], qubits[3]);
+    backend.u3(0.2, 0.4, 0.6, qubits[0]);
+    backend.x({qubits[0], qubits[3]}, qubits[1]);
+    return qubits;
+  };
+
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  TestFactoredSimulator factoredBackend;
+  runCircuit(qppBackend);
+  runCircuit(factoredBackend);
+  expectNearKets(qppBackend.getStateVector(),
+                 factoredBackend.getStateVector());
+  EXPECT_EQ(1, factoredBackend.numFactors());
+}
+
+// Controls in a basis state do not entangle their qubit with the targets.
+CUDAQ_TEST(QPPFactoredTester, checkBasisStateControls) {
+  TestFactoredSimulator factoredBackend;
+  auto qubits = factoredBackend.allocateQubits(4);
+  factoredBackend.x(qubits[0]);
+  factoredBackend.h(qubits[2]);
+  factoredBackend.x({qubits[0]}, qubits[2]);
+  factoredBackend.x({qubits[1]}, qubits[2]);
+  factoredBackend.x({qubits[0], qubits[1]}, qubits[3]);
+  EXPECT_EQ(4, factoredBackend.numFactors());
+
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  auto qppQubits = qppBackend.allocateQubits(4);
+  qppBackend.x(qppQubits[0]);
+  qppBackend.h(qppQubits[2]);
+  qppBackend.x({qppQubits[0]}, qppQubits[2]);
+  expectNearKets(qppBackend.getStateVector(),
+                 factoredBackend.getStateVector());
+}
+
+CUDAQ_TEST(QPPFactoredTester, checkMeasureAndReset) {
+  TestFactoredSimulator factoredBackend;
+  auto qubits = factoredBackend.allocateQubits(4);
+  factoredBackend.h(qubits[0]);
+  for (std::size_t i = 1; i < qubits.size(); ++i)
+    factoredBackend.x({qubits[0]}, qubits[i]);
+  EXPECT_EQ(1, factoredBackend.numFactors());
+
+  // Measuring a qubit of the GHZ state splits it off, and leaves the others
+  // in the matching basis state.
+  const bool outcome = factoredBackend.mz(qubits[2]);
+  EXPECT_EQ(2, factoredBackend.numFactors());
+  for (auto q : qubits)
+    EXPECT_EQ(outcome, factoredBackend.mz(q));
+
+  factoredBackend.h(qubits[1]);
+  factoredBackend.x({qubits[1]}, qubits[3]);
+  factoredBackend.resetQubit(qubits[1]);
+  factoredBackend.resetQubit(qubits[2]);
+  EXPECT_FALSE(factoredBackend.mz(qubits[1]));
+  EXPECT_FALSE(factoredBackend.mz(qubits[2]));
+
+  // A state vector given at allocation is a factor of its own.
+  qpp::ket psi = factoredBackend.getStateVector();
+  qpp::ket initState = qpp::randket(4);
+  auto initQubits = factoredBackend.allocateQubits(
+      2, initState.data(), cudaq::simulation_precision::fp64);
+  EXPECT_EQ(4 + 1, factoredBackend.numFactors());
+  expectNearKets(qpp::kron(initState, psi), factoredBackend.getStateVector());
+  factoredBackend.deallocateQubits(initQubits);
+  factoredBackend.deallocateQubits(qubits);
+}
+
+// A register much wider than a state vector can hold, as long as its
+// entangled groups are small.
+CUDAQ_TEST(QPPFactoredTester, checkWideState) {
+  constexpr std::size_t numQubits = 100;
+  TestFactoredSimulator factoredBackend;
+  auto qubits = factoredBackend.allocateQubits(numQubits);
+  for (std::size_t i = 0; i < numQubits; i += 2) {
+    factoredBackend.h(qubits[i]);
+    factoredBackend.x({qubits[i]}, qubits[i + 1]);
+  }
+  EXPECT_EQ(numQubits / 2, factoredBackend.numFactors());
+
+  // The two qubits of each Bell pair always agree.
+  const int shots = 100;
+  auto result = factoredBackend.sample(qubits, shots);
+  std::size_t total = 0;
+  for (const auto &[bits, count] : result.counts) {
+    ASSERT_EQ(numQubits, bits.size());
+    for (std::size_t i = 0; i < numQubits; i += 2)
+      EXPECT_EQ(bits[i], bits[i + 1]);
+    total += count;
+  }
+  EXPECT_EQ(shots, total);
+  EXPECT_GT(result.counts.size(), 1);
+
+  auto state = factoredBackend.getSimulationState();
+  std::vector<int> basisState(numQubits, 0);
+  EXPECT_NEAR(std::pow(0.5, numQubits / 4.0),
+              std::abs(state->getAmplitude(basisState)), 1e-9);
+  basisState[0] = 1;
+  EXPECT_NEAR(0.0, std::abs(state->getAmplitude(basisState)), 1e-9);
+  basisState[1] = 1;
+  EXPECT_NEAR(std::pow(0.5, numQubits / 4.0),
+              std::abs(state->getAmplitude(basisState)), 1e-9);
+  EXPECT_THROW(state->getTensor(), std::runtime_error);
+  factoredBackend.deallocateQubits(qubits);
+}
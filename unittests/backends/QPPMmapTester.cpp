@@ -0,0 +1,126 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "CUDAQTestUtils.h"
+#include "MmapCircuitSimulator.cpp"
+
+using namespace nvqir;
+
+namespace {
+/// Uses small blocks, so that the test circuits span several of them.
+class BlockedMmapSimulator : public MmapCircuitSimulator {
+public:
+  BlockedMmapSimulator(std::size_t blockQubits) { localQubits = blockQubits; }
+
+  qpp::ket getStateVector() {
+    flushGateQueue();
+    restoreLayout();
+    return qpp::ket::Map(stateFile.data(), stateFile.size());
+  }
+};
+
+void expectNearKets(const qpp::ket &want, const qpp::ket &got,
+                    double epsilon = 1e-9) {
+  ASSERT_EQ(want.size(), got.size());
+  for (Eigen::Index i = 0; i < want.size(); ++i)
+    EXPECT_NEAR(0.0, std::abs(want(i) - got(i)), epsilon);
+}
+} // namespace
+
+// Gates on qubits inside and across the blocks must give the same state as
+// the in-memory simulator.
+CUDAQ_TEST(QPPMmapTester, checkBlockedGates) {
+  const auto runCircuit = [](auto &backend) {
+    auto qubits = backend.allocateQubits(6);
+    for (auto q : qubits)
+      backend.h(q);
+    for (std::size_t i = 0; i + 1 < qubits.size(); ++i) {
+      backend.x({qubits[i]}, qubits[i + 1]);
+      backend.rz(0.1 * (i + 1), qubits[i + 1]);
+      backend.ry(0.3, qubits[i]);
+    }
+    backend.swap({qubits[0]}, qubits[1], qubits[5]);
+    backend.x({qubits[4]}, qubits[1]);
+    backend.t(qubits[0]);
+    backend.u3(0.2, 0.4, 0.6, qubits[4]);
+    auto state = backend.getStateVector();
+    backend.deallocateQubits(qubits);
+    return state;
+  };
+
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  BlockedMmapSimulator mmapBackend(2);
+  expectNearKets(runCircuit(qppBackend), runCircuit(mmapBackend));
+}
+
+CUDAQ_TEST(QPPMmapTester, checkGrowState) {
+  BlockedMmapSimulator mmapBackend(2);
+  auto qubits = mmapBackend.allocateQubits(2);
+  mmapBackend.h(qubits[0]);
+  mmapBackend.ry(0.3, qubits[1]);
+  qpp::ket psi = mmapBackend.getStateVector();
+
+  qpp::ket initState = qpp::randket(4);
+  auto initQubits = mmapBackend.allocateQubits(
+      2, initState.data(), cudaq::simulation_precision::fp64);
+  expectNearKets(qpp::kron(initState, psi), mmapBackend.getStateVector());
+  mmapBackend.deallocateQubits(initQubits);
+  mmapBackend.deallocateQubits(qubits);
+
+  // A new register starts from |000>.
+  qubits = mmapBackend.allocateQubits(3);
+  qpp::ket zeroState = qpp::ket::Zero(8);
+  zeroState(0) = 1.0;
+  expectNearKets(zeroState, mmapBackend.getStateVector());
+  mmapBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPMmapTester, checkMeasureAndSample) {
+  BlockedMmapSimulator mmapBackend(2);
+  auto qubits = mmapBackend.allocateQubits(4);
+  mmapBackend.x(qubits[3]);
+  mmapBackend.h(qubits[0]);
+
+  const int shots = 1000;
+  auto result = mmapBackend.sample({qubits[3], qubits[0]}, shots);
+  EXPECT_EQ(2, result.counts.size());
+  EXPECT_EQ(shots, result.counts["10"] + result.counts["11"]);
+  EXPECT_GT(result.counts["10"], shots / 4);
+  EXPECT_GT(result.counts["11"], shots / 4);
+
+  EXPECT_TRUE(mmapBackend.mz(qubits[3]));
+  const bool outcome = mmapBackend.mz(qubits[0]);
+  EXPECT_EQ(outcome, mmapBackend.mz(qubits[0]));
+
+  mmapBackend.resetQubit(qubits[3]);
+  mmapBackend.resetQubit(qubits[0]);
+  EXPECT_FALSE(mmapBackend.mz(qubits[3]));
+  EXPECT_FALSE(mmapBackend.mz(qubits[0]));
+  mmapBackend.deallocateQubits(qubits);
+
+  // Qubits used over and over are swapped into the blocks; sampling and
+  // measurements follow them there.
+  qubits = mmapBackend.allocateQubits(5);
+  for (int layer = 0; layer < 4; ++layer)
+    mmapBackend.x({qubits[0]}, qubits[4]);
+  mmapBackend.x(qubits[4]);
+  result = mmapBackend.sample({qubits[4], qubits[1]}, shots);
+  EXPECT_EQ(1, result.counts.size());
+  EXPECT_EQ(shots, result.counts["10"]);
+  EXPECT_TRUE(mmapBackend.mz(qubits[4]));
+  mmapBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPMmapTester, checkStateDirectory) {
+  setenv("CUDAQ_MMAP_STATE_DIR", "/nonexistent-cudaq-state-dir", 1);
+  MmapCircuitSimulator mmapBackend;
+  unsetenv("CUDAQ_MMAP_STATE_DIR");
+  EXPECT_THROW(mmapBackend.allocateQubits(2), std::runtime_error);
+}
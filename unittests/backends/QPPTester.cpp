@@ -10,10 +10,15 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <math.h>
+#include <optional>
 
 #include "CUDAQTestUtils.h"
 #include "QppCircuitSimulator.cpp"
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 #define _USE_MATH_DEFINES
 
 using namespace nvqir;
@@ -1236,3 +1241,610 @@ CUDAQ_TEST(QPPTester, checkReset) {
     EXPECT_EQ(1, qppBackend.mz(q1));
   }
 }
+
+// Compare the native in-place gate kernels against Q++ for dense gates on
+// 1 to 4 targets, with and without controls.
+CUDAQ_TEST(QPPTester, checkMultiTargetGates) {
+  const std::size_t numQubits = 6;
+  // Q++ indices qubits from the left, CUDA-Q from the right.
+  const auto toQpp = [&](const std::vector<std::size_t> &qubits) {
+    std::vector<std::size_t> converted;
+    for (auto q : qubits)
+      converted.push_back(numQubits - q - 1);
+    return converted;
+  };
+  const std::vector<std::vector<std::size_t>> targetSets{
+      {2}, {0}, {4, 1}, {0, 5}, {2, 0, 5}, {1, 4, 2, 0}};
+  // Qubit 3 is never a target, so it can serve as a control.
+  const std::vector<std::vector<std::size_t>> controlSets{{}, {3}};
+  for (const auto &targets : targetSets) {
+    for (const auto &controls : controlSets) {
+      qpp::ket initState = qpp::randket(1ULL << numQubits);
+      qpp::cmat unitary = qpp::randU(1ULL << targets.size());
+      // `applyCustomOperation` expects row-major data.
+      std::vector<std::complex<double>> matrix;
+      for (Eigen::Index r = 0; r < unitary.rows(); ++r)
+        for (Eigen::Index c = 0; c < unitary.cols(); ++c)
+          matrix.push_back(unitary(r, c));
+
+      QppCircuitSimulator<qpp::ket> qppBackend;
+      auto qubits = qppBackend.allocateQubits(
+          numQubits, initState.data(), cudaq::simulation_precision::fp64);
+      qppBackend.applyCustomOperation(matrix, controls, targets, "custom");
+      qpp::ket want_state =
+          controls.empty()
+              ? qpp::apply(initState, unitary, toQpp(targets))
+              : qpp::applyCTRL(initState, unitary, toQpp(controls),
+                               toQpp(targets));
+      EXPECT_EQ_KETS(want_state, qppBackend.getStateVector());
+      qppBackend.deallocateQubits(qubits);
+    }
+  }
+}
+
+// Gate fusion must not change the final state.
+CUDAQ_TEST(QPPTester, checkGateFusion) {
+  const auto runCircuit = [](QppCircuitSimulator<qpp::ket> &qppBackend) {
+    auto qubits = qppBackend.allocateQubits(5);
+    for (auto q : qubits)
+      qppBackend.h(q);
+    for (std::size_t i = 0; i + 1 < qubits.size(); ++i) {
+      qppBackend.x({qubits[i]}, qubits[i + 1]);
+      qppBackend.rz(0.1 * (i + 1), qubits[i + 1]);
+      qppBackend.ry(0.3, qubits[i]);
+    }
+    qppBackend.swap({qubits[0]}, qubits[3], qubits[4]);
+    qppBackend.t(qubits[2]);
+    auto state = qppBackend.getStateVector();
+    qppBackend.deallocateQubits(qubits);
+    return state;
+  };
+
+  QppCircuitSimulator<qpp::ket> unfusedBackend;
+  qpp::ket want_state = runCircuit(unfusedBackend);
+
+  setenv("CUDAQ_FUSION_MAX_QUBITS", "3", 1);
+  QppCircuitSimulator<qpp::ket> fusedBackend;
+  unsetenv("CUDAQ_FUSION_MAX_QUBITS");
+  EXPECT_EQ_KETS(want_state, runCircuit(fusedBackend));
+}
+
+CUDAQ_TEST(QPPTester, checkCacheBlocking) {
+  struct Result {
+    double observed;
+    double parity;
+    qpp::ket state;
+  };
+  const auto runCircuit = [](QppCircuitSimulator<qpp::ket> &qppBackend) {
+    qppBackend.setRandomSeed(13);
+    auto qubits = qppBackend.allocateQubits(7);
+    for (auto q : qubits)
+      qppBackend.h(q);
+    // The top qubits are used over and over, so they move into the blocks.
+    for (int layer = 0; layer < 3; ++layer) {
+      for (std::size_t i = 0; i + 1 < qubits.size(); ++i) {
+        qppBackend.x({qubits[i]}, qubits[i + 1]);
+        qppBackend.ry(0.2 * (i + layer + 1), qubits[6 - i]);
+      }
+      qppBackend.rz(0.7, qubits[6]);
+      qppBackend.x({qubits[6], qubits[5]}, qubits[0]);
+      qppBackend.swap(qubits[1], qubits[6]);
+    }
+    Result result;
+    auto op = cudaq::spin_op::z(6) * cudaq::spin_op::x(0) +
+              0.5 * cudaq::spin_op::y(5) * cudaq::spin_op::z(1);
+    result.observed =
+        qppBackend.observe(cudaq::spin_op::canonicalize(op)).expectation();
+    result.parity =
+        qppBackend.sample({qubits[6], qubits[2]}, 0).expectationValue.value();
+
+    // Grow the state and reset a qubit with the qubits out of order.
+    auto extra = qppBackend.allocateQubit();
+    qppBackend.x({qubits[6]}, extra);
+    qppBackend.h(qubits[5]);
+    qppBackend.resetQubit(qubits[6]);
+    qppBackend.ry(0.4, qubits[6]);
+    result.state = qppBackend.getStateVector();
+    qppBackend.deallocate(extra);
+    qppBackend.deallocateQubits(qubits);
+    return result;
+  };
+
+  setenv("CUDAQ_CACHE_BLOCK_QUBITS", "0", 1);
+  QppCircuitSimulator<qpp::ket> unblockedBackend;
+  setenv("CUDAQ_CACHE_BLOCK_QUBITS", "2", 1);
+  QppCircuitSimulator<qpp::ket> blockedBackend;
+  unsetenv("CUDAQ_CACHE_BLOCK_QUBITS");
+  const auto want = runCircuit(unblockedBackend);
+  const auto got = runCircuit(blockedBackend);
+  EXPECT_NEAR(want.observed, got.observed, 1e-9);
+  EXPECT_NEAR(want.parity, got.parity, 1e-9);
+  EXPECT_EQ_KETS(want.state, got.state);
+
+  // Sampling follows the qubits wherever the blocks put them.
+  auto qubits = blockedBackend.allocateQubits(6);
+  for (int layer = 0; layer < 4; ++layer)
+    for (std::size_t i = 0; i + 1 < qubits.size(); ++i)
+      blockedBackend.x({qubits[i]}, qubits[5 - i]);
+  blockedBackend.x(qubits[4]);
+  blockedBackend.x({qubits[4]}, qubits[5]);
+  auto counts = blockedBackend.sample({qubits[0], qubits[4], qubits[5]}, 100);
+  EXPECT_EQ(1, counts.counts.size());
+  EXPECT_EQ(100, counts.counts["011"]);
+  EXPECT_TRUE(blockedBackend.mz(qubits[5]));
+  blockedBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkSampleMarginals) {
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  auto qubits = qppBackend.allocateQubits(3);
+  qppBackend.x(qubits[2]);
+  qppBackend.h(qubits[0]);
+
+  // The bitstring follows the order of the requested qubits.
+  const int shots = 1000;
+  auto result = qppBackend.sample({qubits[2], qubits[0]}, shots);
+  EXPECT_EQ(2, result.counts.size());
+  EXPECT_EQ(shots, result.counts["10"] + result.counts["11"]);
+  EXPECT_GT(result.counts["10"], shots / 4);
+  EXPECT_GT(result.counts["11"], shots / 4);
+  qppBackend.deallocateQubits(qubits);
+
+  // Enough measured qubits to sample over the full index space.
+  qubits = qppBackend.allocateQubits(12);
+  std::string want_bitstring(qubits.size(), '0');
+  for (std::size_t i = 0; i < qubits.size(); i += 3) {
+    qppBackend.x(qubits[i]);
+    want_bitstring[i] = '1';
+  }
+  cudaq::ExecutionContext fullCtx("sample", shots);
+  qppBackend.setExecutionContext(&fullCtx);
+  qppBackend.resetExecutionContext();
+  EXPECT_EQ(1, fullCtx.result.size());
+  EXPECT_EQ(shots, fullCtx.result.count(want_bitstring));
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkObservePauliSum) {
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  auto qubits = qppBackend.allocateQubits(3);
+  // Bell pair on qubits 0 and 1, and ry(0.4) on qubit 2.
+  qppBackend.h(qubits[0]);
+  qppBackend.x({qubits[0]}, qubits[1]);
+  qppBackend.ry(0.4, qubits[2]);
+
+  auto op = 2.0 * cudaq::spin_op::z(0) * cudaq::spin_op::z(1) +
+            0.5 * cudaq::spin_op::x(0) * cudaq::spin_op::x(1) -
+            cudaq::spin_op::y(0) * cudaq::spin_op::y(1) +
+            3.0 * cudaq::spin_op::z(2) + cudaq::spin_op::x(2) +
+            cudaq::spin_op::z(0);
+  auto result = qppBackend.observe(cudaq::spin_op::canonicalize(op));
+  const double want = 2.0 + 0.5 + 1.0 + 3.0 * std::cos(0.4) + std::sin(0.4);
+  EXPECT_NEAR(want, result.expectation(), 1e-9);
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkSinglePrecision) {
+  const auto runCircuit = [](auto &qppBackend) {
+    auto qubits = qppBackend.allocateQubits(4);
+    for (auto q : qubits)
+      qppBackend.h(q);
+    qppBackend.x({qubits[0]}, qubits[2]);
+    qppBackend.ry(0.7, qubits[1]);
+    qppBackend.rz(0.3, qubits[3]);
+    qppBackend.swap({qubits[1]}, qubits[0], qubits[3]);
+    auto state = qppBackend.getStateVector();
+    qppBackend.deallocateQubits(qubits);
+    return state;
+  };
+
+  QppCircuitSimulator<qpp::ket> fp64Backend;
+  QppCircuitSimulator<QppKetFp32> fp32Backend;
+  CircuitSimulator &fp64Simulator = fp64Backend;
+  CircuitSimulator &fp32Simulator = fp32Backend;
+  EXPECT_FALSE(fp64Simulator.isSinglePrecision());
+  EXPECT_TRUE(fp32Simulator.isSinglePrecision());
+  qpp::ket want_state = runCircuit(fp64Backend);
+  qpp::ket got_state = runCircuit(fp32Backend).cast<std::complex<double>>();
+  EXPECT_EQ_KETS(want_state, got_state, 1e-5);
+
+  // User-provided state data must match the simulator precision.
+  std::vector<std::complex<double>> fp64Data{0.0, 1.0};
+  EXPECT_THROW(fp32Backend.allocateQubits(1, fp64Data.data(),
+                                          cudaq::simulation_precision::fp64),
+               std::runtime_error);
+  std::vector<std::complex<float>> fp32Data{0.0, 1.0};
+  auto qubits = fp32Backend.allocateQubits(1, fp32Data.data(),
+                                           cudaq::simulation_precision::fp32);
+  auto simState = fp32Backend.getSimulationState();
+  EXPECT_EQ(cudaq::SimulationState::precision::fp32,
+            simState->getPrecision());
+  EXPECT_NEAR(1.0, std::abs(simState->getAmplitude({1})), 1e-6);
+  fp32Backend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkGrowState) {
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  auto qubits = qppBackend.allocateQubits(2);
+  qppBackend.h(qubits[0]);
+  qppBackend.ry(0.3, qubits[1]);
+  qpp::ket psi = qppBackend.getStateVector();
+
+  // New qubits in |0> are the most significant ones.
+  auto zeroQubit = qppBackend.allocateQubit();
+  EXPECT_EQ_KETS(qpp::kron(getZeroState(1), psi),
+                 qppBackend.getStateVector());
+
+  // New qubits in a user-provided state.
+  qpp::ket initState = qpp::randket(4);
+  auto initQubits = qppBackend.allocateQubits(
+      2, initState.data(), cudaq::simulation_precision::fp64);
+  EXPECT_EQ_KETS(qpp::kron(initState, qpp::kron(getZeroState(1), psi)),
+                 qppBackend.getStateVector());
+  qppBackend.deallocateQubits(initQubits);
+  qppBackend.deallocate(zeroQubit);
+  qppBackend.deallocateQubits(qubits);
+}
+
+namespace {
+class InspectableQppSimulator : public QppCircuitSimulator<qpp::ket> {
+public:
+  std::size_t pooledBytes() const { return statePool.pooledBytes(); }
+  const void *stateData() const { return state.data(); }
+  std::size_t numCheckpointGates() const { return checkpointGates.size(); }
+  void disableStatePool() { statePool.configure(0, false); }
+};
+} // namespace
+
+CUDAQ_TEST(QPPTester, checkStatePoolReuse) {
+  InspectableQppSimulator qppBackend;
+  auto qubits = qppBackend.allocateQubits(3);
+  for (auto q : qubits)
+    qppBackend.x(q);
+  qpp::ket excited = qppBackend.getStateVector();
+  EXPECT_NEAR(std::abs(excited(7)), 1.0, 1e-12);
+  const void *buffer = qppBackend.stateData();
+  qppBackend.deallocateQubits(qubits);
+  EXPECT_EQ(8 * sizeof(std::complex<double>), qppBackend.pooledBytes());
+
+  // A new register of the same size reuses the buffer, cleared to |000>.
+  qubits = qppBackend.allocateQubits(3);
+  EXPECT_EQ(buffer, qppBackend.stateData());
+  EXPECT_EQ(0, qppBackend.pooledBytes());
+  EXPECT_EQ_KETS(getZeroState(3), qppBackend.getStateVector());
+  qppBackend.deallocateQubits(qubits);
+
+  // A different size gets its own buffer.
+  qubits = qppBackend.allocateQubits(4);
+  EXPECT_NE(buffer, qppBackend.stateData());
+  EXPECT_EQ(8 * sizeof(std::complex<double>), qppBackend.pooledBytes());
+  EXPECT_EQ_KETS(getZeroState(4), qppBackend.getStateVector());
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkStatePoolCapacityLimit) {
+  // The automatic capacity grows with the buffers acquired, up to its limit.
+  // Buffers larger than the limit are freed on release, not kept.
+  constexpr std::size_t limit = std::size_t(1) << 20;
+  nvqir::StatePool<qpp::ket> pool;
+  pool.configure(std::nullopt, /*hugePages=*/false, limit);
+  EXPECT_EQ(limit, pool.capacityBytes());
+
+  const std::size_t smallSize = limit / 2 / sizeof(std::complex<double>);
+  pool.release(pool.acquire(smallSize, 1));
+  EXPECT_EQ(limit / 2, pool.pooledBytes());
+
+  pool.release(pool.acquire(4 * smallSize, 1));
+  EXPECT_EQ(limit, pool.capacityBytes());
+  EXPECT_EQ(limit / 2, pool.pooledBytes());
+}
+
+CUDAQ_TEST(QPPTester, checkPrefixCheckpoint) {
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  qppBackend.setRandomSeed(7);
+  cudaq::ExecutionContext ctx("sample", 1);
+  ctx.hasConditionalsOnMeasureResults = true;
+
+  // Kernels with conditionals run shot by shot. Later shots with the same
+  // prefix restore the state at the first measurement.
+  int numOnes = 0;
+  const auto runShot = [&](double angle) {
+    qppBackend.setExecutionContext(&ctx);
+    auto qubits = qppBackend.allocateQubits(3);
+    qppBackend.h(qubits[0]);
+    qppBackend.x({qubits[0]}, qubits[1]);
+    qppBackend.ry(angle, qubits[2]);
+    const bool first = qppBackend.mz(qubits[0]);
+    if (first)
+      qppBackend.x(qubits[2]);
+    EXPECT_EQ(first, qppBackend.mz(qubits[1]));
+    EXPECT_EQ(first != (angle != 0.0), qppBackend.mz(qubits[2]));
+    numOnes += first;
+    qppBackend.deallocateQubits(qubits);
+    qppBackend.resetExecutionContext();
+  };
+
+  const int shots = 40;
+  for (int i = 0; i < shots; ++i)
+    runShot(0.0);
+  // A different prefix replaces the checkpoint.
+  for (int i = 0; i < shots; ++i)
+    runShot(M_PI);
+  for (int i = 0; i < shots; ++i)
+    runShot(0.0);
+  EXPECT_GT(numOnes, 0);
+  EXPECT_LT(numOnes, 3 * shots);
+
+  // Reading the state applies the gates deferred so far.
+  qppBackend.setExecutionContext(&ctx);
+  auto qubits = qppBackend.allocateQubits(3);
+  qppBackend.h(qubits[0]);
+  qppBackend.x({qubits[0]}, qubits[1]);
+  qpp::ket want = qpp::ket::Zero(8);
+  want(0) = want(3) = M_SQRT1_2;
+  EXPECT_EQ_KETS(want, qppBackend.getStateVector());
+  qppBackend.deallocateQubits(qubits);
+  qppBackend.resetExecutionContext();
+}
+
+CUDAQ_TEST(QPPTester, checkMeasurementBranching) {
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  qppBackend.setRandomSeed(11);
+  const std::size_t shots = 2000;
+  cudaq::ExecutionContext ctx("sample", shots);
+  ctx.hasConditionalsOnMeasureResults = true;
+  ctx.allowMeasurementBranching = true;
+
+  // Re-execute the kernel until all shots are collected, as `cudaq::sample`
+  // does. Every execution follows one branch of the measurement results.
+  cudaq::sample_result counts;
+  int executions = 0;
+  while (counts.get_total_shots() < shots) {
+    qppBackend.setExecutionContext(&ctx);
+    auto qubits = qppBackend.allocateQubits(3);
+    qppBackend.h(qubits[0]);
+    if (qppBackend.mz(qubits[0], "a"))
+      qppBackend.x(qubits[1]);
+    qppBackend.ry(0.6, qubits[2]);
+    qppBackend.resetQubit(qubits[2]);
+    qppBackend.ry(0.6, qubits[2]);
+    qppBackend.mz(qubits[2], "b");
+    qppBackend.deallocateQubits(qubits);
+    qppBackend.resetExecutionContext();
+    counts += ctx.result;
+    ctx.result.clear();
+    ++executions;
+  }
+
+  // One execution per distinct measurement record (a, reset, b).
+  EXPECT_LE(executions, 8);
+  EXPECT_EQ(shots, counts.get_total_shots());
+  EXPECT_EQ(shots, counts.count("0", "a") + counts.count("1", "a"));
+  EXPECT_EQ(shots, counts.count("0", "b") + counts.count("1", "b"));
+  // Final states: q1 = a = q0, and q2 = b with probability sin^2(0.3).
+  const double probB = std::pow(std::sin(0.3), 2);
+  for (auto bits : {"000", "110"}) {
+    const double expected = shots * (1.0 - probB) / 2;
+    EXPECT_NEAR(counts.count(bits), expected,
+                5 * std::sqrt(expected * (1.0 - expected / shots)));
+  }
+  for (auto bits : {"001", "111"}) {
+    const double expected = shots * probB / 2;
+    EXPECT_NEAR(counts.count(bits), expected,
+                5 * std::sqrt(expected * (1.0 - expected / shots)));
+  }
+}
+
+// A kernel that throws in the middle of a branching execution leaves pending
+// branches behind. The next sample must not follow them, even though its
+// execution context lives at the same address.
+CUDAQ_TEST(QPPTester, checkInterruptedMeasurementBranching) {
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  qppBackend.setRandomSeed(7);
+  const std::size_t shots = 1000;
+  std::optional<cudaq::ExecutionContext> ctx;
+  const auto makeContext = [&]() -> cudaq::ExecutionContext & {
+    ctx.emplace("sample", shots);
+    ctx->hasConditionalsOnMeasureResults = true;
+    ctx->allowMeasurementBranching = true;
+    return *ctx;
+  };
+
+  auto *firstContext = &makeContext();
+  qppBackend.setExecutionContext(firstContext);
+  auto qubits = qppBackend.allocateQubits(1);
+  try {
+    qppBackend.h(qubits[0]);
+    qppBackend.mz(qubits[0], "a");
+    throw std::runtime_error("kernel failure");
+  } catch (std::runtime_error &) {
+    qppBackend.deallocateQubits(qubits);
+  }
+
+  auto &context = makeContext();
+  ASSERT_EQ(firstContext, &context);
+  cudaq::sample_result counts;
+  int executions = 0;
+  while (counts.get_total_shots() < shots) {
+    qppBackend.setExecutionContext(&context);
+    qubits = qppBackend.allocateQubits(1);
+    qppBackend.x(qubits[0]);
+    if (qppBackend.mz(qubits[0], "b"))
+      qppBackend.h(qubits[0]);
+    qppBackend.deallocateQubits(qubits);
+    qppBackend.resetExecutionContext();
+    counts += context.result;
+    context.result.clear();
+    ++executions;
+  }
+
+  // The only measurement is deterministic, so a single execution carries all
+  // the shots.
+  EXPECT_EQ(1, executions);
+  EXPECT_EQ(shots, counts.count("1", "b"));
+}
+
+// Without memory to save the states at the branching points, the branches
+// are replayed from the start and restore the prefix checkpoint instead.
+CUDAQ_TEST(QPPTester, checkPrefixCheckpointWithBranching) {
+  InspectableQppSimulator qppBackend;
+  qppBackend.disableStatePool();
+  qppBackend.setRandomSeed(5);
+  const std::size_t shots = 1000;
+  cudaq::ExecutionContext ctx("sample", shots);
+  ctx.hasConditionalsOnMeasureResults = true;
+  ctx.allowMeasurementBranching = true;
+
+  cudaq::sample_result counts;
+  int executions = 0;
+  while (counts.get_total_shots() < shots) {
+    qppBackend.setExecutionContext(&ctx);
+    auto qubits = qppBackend.allocateQubits(3);
+    qppBackend.h(qubits[0]);
+    qppBackend.x({qubits[0]}, qubits[1]);
+    qppBackend.ry(0.6, qubits[2]);
+    if (qppBackend.mz(qubits[0], "a"))
+      qppBackend.x(qubits[2]);
+    qppBackend.mz(qubits[1], "b");
+    qppBackend.deallocateQubits(qubits);
+    qppBackend.resetExecutionContext();
+    counts += ctx.result;
+    ctx.result.clear();
+    ++executions;
+  }
+
+  EXPECT_EQ(3, qppBackend.numCheckpointGates());
+  EXPECT_LE(executions, 2);
+  EXPECT_EQ(shots, counts.get_total_shots());
+  // q1 always matches q0, and q2 is flipped when q0 is 1.
+  const double probFlip = std::pow(std::sin(0.3), 2);
+  EXPECT_EQ(counts.count("0", "a"), counts.count("0", "b"));
+  for (auto [bits, probability] :
+       {std::pair{"000", (1 - probFlip) / 2}, std::pair{"001", probFlip / 2},
+        std::pair{"111", (1 - probFlip) / 2}, std::pair{"110", probFlip / 2}}) {
+    const double expected = shots * probability;
+    EXPECT_NEAR(counts.count(bits), expected,
+                5 * std::sqrt(expected * (1.0 - probability)));
+  }
+}
+
+CUDAQ_TEST(QPPTester, checkNoiseTrajectories) {
+  // A unitary mixture (bit flip) attached to x on qubit 0, and a general
+  // channel (amplitude damping) applied directly to qubit 1.
+  cudaq::noise_model noise;
+  noise.add_channel("x", {0}, cudaq::bit_flip_channel(0.2));
+  cudaq::amplitude_damping_channel damping(0.5);
+
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  CircuitSimulator &simulator = qppBackend;
+  qppBackend.setRandomSeed(13);
+  const int shots = 4000;
+  cudaq::ExecutionContext sampleCtx("sample", shots);
+  sampleCtx.noiseModel = &noise;
+  qppBackend.setExecutionContext(&sampleCtx);
+  auto qubits = qppBackend.allocateQubits(2);
+  qppBackend.x(qubits[0]);
+  qppBackend.x(qubits[1]);
+  simulator.applyNoise(damping, {qubits[1]});
+  qppBackend.resetExecutionContext();
+
+  // P(q0 = 1) = 0.8 and P(q1 = 1) = 0.5, independently.
+  std::size_t countQ0 = 0, countQ1 = 0;
+  for (auto &[bits, count] : sampleCtx.result.to_map()) {
+    countQ0 += bits[0] == '1' ? count : 0;
+    countQ1 += bits[1] == '1' ? count : 0;
+  }
+  EXPECT_NEAR(0.8, countQ0 / static_cast<double>(shots), 0.05);
+  EXPECT_NEAR(0.5, countQ1 / static_cast<double>(shots), 0.05);
+  qppBackend.deallocateQubits(qubits);
+
+  cudaq::ExecutionContext observeCtx("observe");
+  observeCtx.noiseModel = &noise;
+  observeCtx.numberTrajectories = 2000;
+  qppBackend.setExecutionContext(&observeCtx);
+  qubits = qppBackend.allocateQubits(2);
+  qppBackend.x(qubits[0]);
+  qppBackend.x(qubits[1]);
+  simulator.applyNoise(damping, {qubits[1]});
+  auto result = qppBackend.observe(cudaq::spin_op::z(0) +
+                                   2.0 * cudaq::spin_op::z(1));
+  // <Z0> = 1 - 2 * 0.8, <Z1> = 1 - 2 * 0.5.
+  EXPECT_NEAR(-0.6, result.expectation(), 0.1);
+  qppBackend.resetExecutionContext();
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkReleaseDeallocatedQubits) {
+  QppCircuitSimulator<qpp::ket> qppBackend;
+  auto qubits = qppBackend.allocateQubits(3);
+  qppBackend.h(qubits[0]);
+  qppBackend.x({qubits[0]}, qubits[1]);
+  qppBackend.h(qubits[2]);
+
+  // The last qubit is reset on deallocation and leaves the state, and its
+  // index is reused by the next allocation.
+  qppBackend.deallocate(qubits[2]);
+  qpp::ket expected = qpp::ket::Zero(4);
+  expected(0) = expected(3) = M_SQRT1_2;
+  EXPECT_EQ_KETS(expected, qppBackend.getStateVector());
+  EXPECT_EQ(qubits[2], qppBackend.allocateQubit());
+  expected.conservativeResize(8);
+  expected.tail(4).setZero();
+  EXPECT_EQ_KETS(expected, qppBackend.getStateVector());
+  qppBackend.deallocateQubits(qubits);
+
+  // Under an execution context, deallocated ancillas in a basis state are
+  // released too, and come back in the implicit sampling of all the qubits.
+  const int shots = 100;
+  cudaq::ExecutionContext ctx("sample", shots);
+  qppBackend.setExecutionContext(&ctx);
+  qubits = qppBackend.allocateQubits(2);
+  qppBackend.h(qubits[0]);
+  qppBackend.x({qubits[0]}, qubits[1]);
+  auto ancilla = qppBackend.allocateQubit();
+  qppBackend.x({qubits[1]}, ancilla);
+  qppBackend.resetQubit(ancilla);
+  qppBackend.deallocate(ancilla);
+  EXPECT_EQ(4, qppBackend.getStateVector().size());
+  auto flipped = qppBackend.allocateQubit();
+  EXPECT_EQ(ancilla, flipped);
+  qppBackend.x(flipped);
+  qppBackend.deallocate(flipped);
+  EXPECT_EQ(4, qppBackend.getStateVector().size());
+  qppBackend.resetExecutionContext();
+
+  std::size_t total = 0;
+  for (auto &[bits, count] : ctx.result.to_map()) {
+    EXPECT_TRUE(bits == "0001" || bits == "1101");
+    total += count;
+  }
+  EXPECT_EQ(shots, total);
+  qppBackend.deallocateQubits(qubits);
+}
+
+CUDAQ_TEST(QPPTester, checkDeterministicReductions) {
+  // Each tiny term is lost when added to 1 on its own.
+  const std::size_t size = 1ULL << 20;
+  const double sum = nvqir::kernels::reduceSum(
+      size, [](std::size_t i) { return i == 0 ? 1.0 : 1e-16; });
+  EXPECT_NEAR(1.0 + (size - 1) * 1e-16, sum, 1e-15);
+
+  // Same bits for any number of threads.
+  const qpp::ket psi = qpp::randket(1ULL << 16);
+  const qpp::ket phi = qpp::randket(1ULL << 16);
+  const auto reduce = [&]() {
+    return std::make_pair(
+        nvqir::kernels::squaredNorm(psi.data(), psi.size()),
+        nvqir::kernels::innerProduct(psi.data(), phi.data(), psi.size()));
+  };
+#if defined(_OPENMP)
+  const int numThreads = omp_get_max_threads();
+  omp_set_num_threads(1);
+  const auto serial = reduce();
+  omp_set_num_threads(std::max(numThreads, 4));
+  EXPECT_EQ(serial, reduce());
+  omp_set_num_threads(numThreads);
+#endif
+  EXPECT_NEAR(1.0, reduce().first, 1e-12);
+  EXPECT_NEAR(0.0, std::abs(psi.dot(phi) - reduce().second), 1e-12);
+}
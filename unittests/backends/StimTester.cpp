@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include "CUDAQTestUtils.h"
+#include "StimCircuitSimulator.cpp"
+
+using namespace nvqir;
+
+namespace {
+/// Apply a Clifford circuit with measurements, resets and a random pair of
+/// correlated bits, and return the result of each measurement in order.
+std::vector<bool> runMeasurementCircuit(StimCircuitSimulator &backend) {
+  auto q = backend.allocateQubits(4);
+  std::vector<bool> results;
+  backend.x(q[0]);
+  results.push_back(backend.mz(q[1]));
+  results.push_back(backend.mz(q[0]));
+  backend.x({q[0]}, q[1]);
+  results.push_back(backend.mz(q[1]));
+  backend.resetQubit(q[0]);
+  results.push_back(backend.mz(q[0]));
+  backend.h(q[2]);
+  backend.x({q[2]}, q[3]);
+  results.push_back(backend.mz(q[3]));
+  results.push_back(backend.mz(q[2]));
+  backend.x(q[2]);
+  results.push_back(backend.mz(q[2]));
+  backend.deallocateQubits(q);
+  return results;
+}
+} // namespace
+
+// Measurements queued in explicit measurement mode stay in the pending
+// circuit, with the gates around them. The record must be the one of the
+// same operations applied one by one.
+CUDAQ_TEST(StimTester, checkPendingMeasurements) {
+  StimCircuitSimulator backend;
+  backend.setRandomSeed(3);
+
+  // Without an execution context, every measurement runs right away.
+  std::set<bool> pairValues;
+  for (int i = 0; i < 20; i++) {
+    const auto results = runMeasurementCircuit(backend);
+    ASSERT_EQ(7, results.size());
+    EXPECT_EQ((std::vector<bool>{false, true, true, false}),
+              std::vector<bool>(results.begin(), results.begin() + 4));
+    EXPECT_EQ(results[4], results[5]);
+    EXPECT_NE(results[5], results[6]);
+    pairValues.insert(results[4]);
+  }
+  EXPECT_EQ(2, pairValues.size());
+
+  const std::size_t shots = 100;
+  cudaq::ExecutionContext ctx("sample", shots);
+  ctx.explicitMeasurements = true;
+  backend.setExecutionContext(&ctx);
+  runMeasurementCircuit(backend);
+  backend.resetExecutionContext();
+
+  const auto records = ctx.result.sequential_data();
+  ASSERT_EQ(shots, records.size());
+  std::set<std::string> pairs;
+  for (const auto &record : records) {
+    ASSERT_EQ(7, record.size());
+    EXPECT_EQ("0110", record.substr(0, 4));
+    EXPECT_EQ(record[4], record[5]);
+    EXPECT_NE(record[5], record[6]);
+    pairs.insert(record.substr(4));
+  }
+  EXPECT_EQ((std::set<std::string>{"001", "110"}), pairs);
+}
+
+namespace {
+/// Sample a GHZ state on 3 qubits with the given number of threads and seed,
+/// and return the records of the shots.
+std::vector<std::string> sampleGhz(const char *numThreads, std::size_t shots,
+                                   std::size_t seed) {
+  setenv("CUDAQ_STIM_NUM_THREADS", numThreads, 1);
+  StimCircuitSimulator backend;
+  unsetenv("CUDAQ_STIM_NUM_THREADS");
+  backend.setRandomSeed(seed);
+
+  cudaq::ExecutionContext ctx("sample", shots);
+  backend.setExecutionContext(&ctx);
+  auto q = backend.allocateQubits(3);
+  backend.h(q[0]);
+  backend.x({q[0]}, q[1]);
+  backend.x({q[1]}, q[2]);
+  for (auto qubit : q)
+    backend.mz(qubit);
+  backend.resetExecutionContext();
+  return ctx.result.sequential_data();
+}
+} // namespace
+
+// Large samples are split into several batches of shots, with a last partial
+// batch here. Every shot must keep its correlations, and the results of a
+// seeded sample must not depend on the number of threads.
+CUDAQ_TEST(StimTester, checkShotBatches) {
+  const std::size_t shots = 3 * 4096 + 100;
+  const auto records = sampleGhz("4", shots, 13);
+  ASSERT_EQ(shots, records.size());
+  std::size_t numOnes = 0;
+  for (const auto &record : records) {
+    ASSERT_TRUE(record == "000" || record == "111") << record;
+    numOnes += record == "111";
+  }
+  // Both outcomes show up in the last partial batch too.
+  std::set<std::string> lastBatch(records.end() - 100, records.end());
+  EXPECT_EQ(2, lastBatch.size());
+  EXPECT_NEAR(0.5, static_cast<double>(numOnes) / shots, 0.05);
+
+  EXPECT_EQ(records, sampleGhz("1", shots, 13));
+}
+
+// Detectors look back at the measurements in the order of the `mz` calls, not
+// in the order they are sampled in, and they don't change what is sampled.
+CUDAQ_TEST(StimTester, checkDetectorMeasurementOrder) {
+  StimCircuitSimulator backend;
+  backend.setRandomSeed(13);
+
+  const std::size_t shots = 100;
+  cudaq::ExecutionContext ctx("sample", shots);
+  backend.setExecutionContext(&ctx);
+  auto q = backend.allocateQubits(3);
+  // The flip makes the measurement of q[0] differ from the noiseless one in
+  // every shot.
+  backend.applyNoise(cudaq::bit_flip_channel(1.), {q[0]});
+  backend.mz(q[2], "a");
+  backend.mz(q[0], "b");
+  backend.addDetector({-1});
+  backend.addDetector({-2});
+  backend.resetExecutionContext();
+  backend.deallocateQubits(q);
+
+  const auto &result = ctx.result;
+  EXPECT_EQ((cudaq::CountsDictionary{{"10", shots}}), result.to_map());
+  EXPECT_EQ((cudaq::CountsDictionary{{"0", shots}}), result.to_map("a"));
+  EXPECT_EQ((cudaq::CountsDictionary{{"1", shots}}), result.to_map("b"));
+  EXPECT_EQ((cudaq::CountsDictionary{{"10", shots}}),
+            result.to_map("__detectors__"));
+}
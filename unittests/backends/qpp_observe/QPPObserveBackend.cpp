@@ -22,6 +22,7 @@ public:
   cudaq::observe_result observe(const cudaq::spin_op &op) override {
     assert(cudaq::spin_op::canonicalize(op) == op);
     flushGateQueue();
+    restoreLayout();
 
     ::qpp::cmat X = ::qpp::Gates::get_instance().X;
     ::qpp::cmat Y = ::qpp::Gates::get_instance().Y;
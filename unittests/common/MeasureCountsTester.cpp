@@ -64,3 +64,36 @@ CUDAQ_TEST(MeasureCountsTester, checkMeasureCountsSerialize) {
 
   EXPECT_TRUE(mm == mc);
 }
+
+CUDAQ_TEST(MeasureCountsTester, checkPackedShots) {
+  // Three shots of 70 bits, starting at bit 3 of rows of two words.
+  auto words = std::make_shared<std::vector<std::uint64_t>>(
+      std::vector<std::uint64_t>{0b1000, 1ULL << 8, 0b1000, 1ULL << 8, 0, 0});
+  PackedShots packed;
+  packed.numShots = 3;
+  packed.numBits = 70;
+  packed.bitOffset = 3;
+  packed.rowStride = 2;
+  packed.words = words->data();
+  packed.storage = words;
+
+  std::string first(70, '0');
+  first[0] = '1';
+  first[64 + 5] = '1';
+  const std::string second(70, '0');
+  EXPECT_EQ(first, packed.bitString(0));
+  EXPECT_EQ((CountsDictionary{{first, 2}, {second, 1}}), packed.counts());
+
+  ExecutionResult r(packed.counts());
+  r.packedShots = packed;
+  cudaq::sample_result mc(r);
+  EXPECT_EQ(2, mc.count(first));
+  EXPECT_EQ((std::vector<std::string>{first, first, second}),
+            mc.sequential_data());
+
+  // Appending to the result first turns the packed shots into strings.
+  r.appendResult(second, 1);
+  EXPECT_FALSE(r.packedShots.has_value());
+  EXPECT_EQ((std::vector<std::string>{first, first, second, second}),
+            r.sequentialData);
+}
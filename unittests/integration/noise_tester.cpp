@@ -8,6 +8,7 @@
 
 #include "CUDAQTestUtils.h"
 #include <cudaq/algorithm.h>
+#include <cudaq/algorithms/detector_error_model.h>
 #include <set>
 #include <stdio.h>
 
@@ -1084,3 +1085,85 @@ CUDAQ_TEST(NoiseTest, checkNoiseMatrixRepresentation) {
   cudaq::unset_noise(); // clear for subsequent tests
 }
 #endif
+
+#if defined(CUDAQ_BACKEND_STIM)
+
+CUDAQ_TEST(NoiseTest, checkDetectorsAndObservables) {
+  cudaq::set_random_seed(13);
+  cudaq::bit_flip_channel bf(.3);
+  cudaq::noise_model noise;
+  noise.add_channel<cudaq::types::x>({1}, bf);
+  cudaq::set_noise(noise);
+
+  auto kernel = []() __qpu__ {
+    cudaq::qvector q(2);
+    x(q[1]);
+    mz(q[0]);
+    mz(q[1]);
+    cudaq::detector({-1});
+    cudaq::logical_observable(0, {-2});
+    cudaq::logical_observable(1, {-1, -2});
+  };
+
+  const std::size_t shots = 1000;
+  auto counts = cudaq::sample(shots, kernel);
+  auto detectors = counts.packed_shots("__detectors__");
+  auto observables = counts.packed_shots("__observables__");
+  ASSERT_TRUE(detectors.has_value());
+  ASSERT_TRUE(observables.has_value());
+  EXPECT_EQ(shots, detectors->numShots);
+  EXPECT_EQ(1, detectors->numBits);
+  EXPECT_EQ(2, observables->numBits);
+
+  // The bit flip on the second qubit fires the detector and flips the second
+  // observable, the first one is never flipped.
+  std::size_t numEvents = 0;
+  for (std::size_t shot = 0; shot < shots; shot++) {
+    EXPECT_FALSE(observables->bit(shot, 0));
+    EXPECT_EQ(detectors->bit(shot, 0), observables->bit(shot, 1));
+    numEvents += detectors->bit(shot, 0);
+  }
+  EXPECT_NEAR(.3, static_cast<double>(numEvents) / shots, .1);
+  EXPECT_EQ(shots, counts.sequential_data("__detectors__").size());
+
+  const auto dem = cudaq::detector_error_model(kernel);
+  EXPECT_NE(std::string::npos, dem.find("error(0.3) D0 L1")) << dem;
+  cudaq::unset_noise(); // clear for subsequent tests
+}
+
+CUDAQ_TEST(NoiseTest, checkStimExactObserve) {
+  auto bell = []() __qpu__ {
+    cudaq::qvector q(2);
+    h(q[0]);
+    x<cudaq::ctrl>(q[0], q[1]);
+  };
+
+  // Stabilizer expectations are exact without noise.
+  cudaq::spin_op h = 2. * cudaq::spin_op::z(0) * cudaq::spin_op::z(1) +
+                     cudaq::spin_op::x(0) * cudaq::spin_op::x(1) -
+                     3. * cudaq::spin_op::y(0) * cudaq::spin_op::y(1) +
+                     5. * cudaq::spin_op::z(0);
+  EXPECT_EQ(6., cudaq::observe(bell, h));
+
+  // With shots, the terms are sampled.
+  auto sampled = cudaq::observe(1000, bell, cudaq::spin_op::z(0));
+  EXPECT_EQ(2, sampled.counts(cudaq::spin_op::z(0)).size());
+  EXPECT_NEAR(0., sampled.expectation(), .2);
+
+  // Under noise, each term is averaged over the noise trajectories.
+  cudaq::set_random_seed(13);
+  cudaq::bit_flip_channel bf(.3);
+  cudaq::noise_model noise;
+  noise.add_channel<cudaq::types::x>({1}, bf);
+  cudaq::set_noise(noise);
+
+  auto flip = []() __qpu__ {
+    cudaq::qvector q(2);
+    x(q[1]);
+  };
+  auto result =
+      cudaq::observe(flip, cudaq::spin_op::z(0) + cudaq::spin_op::z(1));
+  EXPECT_NEAR(1. - .4, result.expectation(), .1);
+  cudaq::unset_noise(); // clear for subsequent tests
+}
+#endif
@@ -0,0 +1,152 @@
+/*******************************************************************************
+ * Copyright (c) 2022 - 2025 NVIDIA Corporation & Affiliates.                  *
+ * All rights reserved.                                                        *
+ *                                                                             *
+ * This source code and the accompanying materials are made available under    *
+ * the terms of the Apache License 2.0 which accompanies this distribution.    *
+ ******************************************************************************/
+#include <cudaq.h>
+#include <gtest/gtest.h>
+#include <optional>
+
+// The state is split over the ranks from 2 local qubits per rank, so that
+// these small kernels already exercise the global-local qubit swaps.
+constexpr std::size_t numQubits = 8;
+
+TEST(QppMPITester, checkSampleGhz) {
+  auto kernel = []() __qpu__ {
+    cudaq::qvector q(numQubits);
+    h(q[0]);
+    for (std::size_t i = 0; i + 1 < numQubits; i++)
+      x<cudaq::ctrl>(q[i], q[i + 1]);
+    mz(q);
+  };
+
+  const std::size_t shots = 1000;
+  auto counts = cudaq::sample(shots, kernel);
+  EXPECT_EQ(2, counts.size());
+  EXPECT_EQ(shots, counts.count(std::string(numQubits, '0')) +
+                       counts.count(std::string(numQubits, '1')));
+
+  // All ranks report the same counts.
+  const double zeros = counts.count(std::string(numQubits, '0'));
+  EXPECT_NEAR(zeros * cudaq::mpi::num_ranks(),
+              cudaq::mpi::all_reduce(zeros, std::plus<double>()), 1e-9);
+}
+
+TEST(QppMPITester, checkGetState) {
+  auto kernel = []() __qpu__ {
+    cudaq::qvector q(numQubits);
+    for (std::size_t i = 0; i < numQubits; i++)
+      ry(0.1 + 0.3 * i, q[i]);
+    // An entangling layer followed by its inverse.
+    for (std::size_t i = 0; i + 1 < numQubits; i++)
+      x<cudaq::ctrl>(q[i], q[i + 1]);
+    for (std::size_t i = numQubits - 1; i > 0; i--)
+      x<cudaq::ctrl>(q[i - 1], q[i]);
+  };
+
+  auto state = cudaq::get_state(kernel);
+  for (std::size_t index = 0; index < (1ULL << numQubits); index += 7) {
+    double want = 1.0;
+    for (std::size_t i = 0; i < numQubits; i++) {
+      const double half = (0.1 + 0.3 * i) / 2;
+      want *= ((index >> i) & 1) ? std::sin(half) : std::cos(half);
+    }
+    std::vector<int> basisState;
+    for (std::size_t i = 0; i < numQubits; i++)
+      basisState.push_back((index >> i) & 1);
+    EXPECT_NEAR(want, std::real(state.amplitude(basisState)), 1e-9);
+  }
+}
+
+TEST(QppMPITester, checkObserve) {
+  auto kernel = []() __qpu__ {
+    cudaq::qvector q(numQubits);
+    h(q[0]);
+    for (std::size_t i = 0; i + 1 < numQubits; i++)
+      x<cudaq::ctrl>(q[i], q[i + 1]);
+  };
+
+  auto xString = cudaq::spin_op::x(0);
+  for (std::size_t i = 1; i < numQubits; i++)
+    xString *= cudaq::spin_op::x(i);
+  auto op = 2.0 * cudaq::spin_op::z(0) * cudaq::spin_op::z(numQubits - 1) +
+            0.5 * xString + cudaq::spin_op::z(numQubits - 1);
+  EXPECT_NEAR(2.5, cudaq::observe(kernel, op), 1e-9);
+}
+
+// Gates controlled by a global qubit only apply on some ranks, but every rank
+// must keep the same qubit layout, or the later global-local swaps exchange
+// mismatched halves. Compare with a single-process state vector.
+TEST(QppMPITester, checkGlobalControlLayout) {
+  auto kernel = []() __qpu__ {
+    cudaq::qvector q(numQubits);
+    // Rotating the last qubits makes them local, the first ones taking their
+    // global positions.
+    for (std::size_t i = 0; i < numQubits; i++)
+      ry(0.2 + 0.3 * i, q[i]);
+    for (std::size_t i = 2; i + 2 < numQubits; i++)
+      x<cudaq::ctrl>(q[0], q[i]);
+    // Targeting the global qubits swaps them with the least recently used
+    // local ones.
+    h(q[0]);
+    h(q[1]);
+    x<cudaq::ctrl>(q[1], q[2]);
+    ry(0.7, q[3]);
+  };
+
+  // The same circuit on a single-process real state vector.
+  std::vector<double> want(1ULL << numQubits, 0.0);
+  want[0] = 1.0;
+  const auto apply = [&](std::size_t target, double m00, double m01,
+                         double m10, double m11,
+                         std::optional<std::size_t> control = {}) {
+    for (std::size_t i = 0; i < want.size(); i++) {
+      if ((i >> target) & 1)
+        continue;
+      if (control && !((i >> *control) & 1))
+        continue;
+      const std::size_t j = i | (1ULL << target);
+      const double a0 = want[i], a1 = want[j];
+      want[i] = m00 * a0 + m01 * a1;
+      want[j] = m10 * a0 + m11 * a1;
+    }
+  };
+  const auto ry = [&](double theta, std::size_t target) {
+    const double c = std::cos(theta / 2), s = std::sin(theta / 2);
+    apply(target, c, -s, s, c);
+  };
+  const double r = 1.0 / std::sqrt(2.0);
+  const auto h = [&](std::size_t target) { apply(target, r, r, r, -r); };
+  const auto cx = [&](std::size_t control, std::size_t target) {
+    apply(target, 0, 1, 1, 0, control);
+  };
+  for (std::size_t i = 0; i < numQubits; i++)
+    ry(0.2 + 0.3 * i, i);
+  for (std::size_t i = 2; i + 2 < numQubits; i++)
+    cx(0, i);
+  h(0);
+  h(1);
+  cx(1, 2);
+  ry(0.7, 3);
+
+  auto state = cudaq::get_state(kernel);
+  for (std::size_t index = 0; index < want.size(); index++) {
+    std::vector<int> basisState;
+    for (std::size_t i = 0; i < numQubits; i++)
+      basisState.push_back((index >> i) & 1);
+    const auto amplitude = state.amplitude(basisState);
+    EXPECT_NEAR(want[index], std::real(amplitude), 1e-9) << index;
+    EXPECT_NEAR(0.0, std::imag(amplitude), 1e-9) << index;
+  }
+}
+
+int main(int argc, char **argv) {
+  setenv("CUDAQ_MPI_MIN_LOCAL_QUBITS", "2", 1);
+  ::testing::InitGoogleTest(&argc, argv);
+  cudaq::mpi::initialize();
+  const auto testResult = RUN_ALL_TESTS();
+  cudaq::mpi::finalize();
+  return testResult;
+}